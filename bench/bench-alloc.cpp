@@ -0,0 +1,61 @@
+// -*- compile-command: "cd .. && make bench" -*-
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+#include <fault_injection_alloc.hpp>
+
+#if defined(__linux__)
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void __libc_free(void * ptr);
+#endif
+
+static constexpr unsigned long iterations = 20000000;
+// Rounds are interleaved and the fastest one is reported so frequency
+// changes and noise of other processes affect both variants alike
+static constexpr unsigned int rounds = 5;
+
+static void * volatile sink;
+
+template<typename Allocate, typename Release>
+static double measure(Allocate allocate, Release release)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < iterations; ++i) {
+		void * ptr = allocate(64);
+		sink = ptr;
+		release(ptr);
+	}
+
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / iterations;
+}
+
+int main()
+{
+	// Keep the hook module linked in
+	avm::fault_injection::alloc::resetPolicy(avm::fault_injection::alloc::function_t::malloc);
+
+	double hooked = std::numeric_limits<double>::max();
+	double direct = std::numeric_limits<double>::max();
+
+	for (unsigned int i = 0; i < rounds; ++i) {
+		hooked = std::min(hooked, measure([](size_t size) { return malloc(size); }, [](void * ptr) { free(ptr); }));
+#if defined(__linux__)
+		direct = std::min(direct, measure([](size_t size) { return __libc_malloc(size); }, [](void * ptr) { __libc_free(ptr); }));
+#endif
+	}
+
+	std::printf("hooked malloc/free:  %6.2f ns\n", hooked);
+#if defined(__linux__)
+	std::printf("libc malloc/free:    %6.2f ns\n", direct);
+	std::printf("overhead:            %6.2f ns\n", hooked - direct);
+#endif
+
+	return 0;
+}
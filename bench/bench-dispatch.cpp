@@ -0,0 +1,56 @@
+// -*- compile-command: "cd .. && make bench" -*-
+#include <chrono>
+#include <cstdio>
+
+#include <fault_injection.hpp>
+
+FAULT_INJECTION_POINT(bench, dispatch, "Version dispatch");
+
+static constexpr unsigned long iterations = 200000000;
+
+// Hide point definition from optimizer like for points from registry
+static avm::fault_injection::point_t * volatile point = &FAULT_INJECTION_POINT_REF(bench, dispatch);
+
+static __attribute__((noinline)) int generic(const avm::fault_injection::point_t & point)
+{
+	return avm::fault_injection::isActive(point) ? avm::fault_injection::getErrorCode(point) : 1;
+}
+
+static __attribute__((noinline)) int current(const avm::fault_injection::point_t & point)
+{
+	using namespace avm::fault_injection::detail;
+
+	return current::isActive(point) ? current::getErrorCode(point) : 1;
+}
+
+template<typename Function>
+static double measure(Function function)
+{
+	const avm::fault_injection::point_t & target = *point;
+	unsigned long sum = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < iterations; ++i) {
+		sum += function(target);
+	}
+
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (sum != iterations) {
+		std::printf("unexpected result\n");
+	}
+
+	return elapsed.count() / iterations;
+}
+
+int main()
+{
+	const double dispatched = measure(generic);
+	const double direct = measure(current);
+
+	std::printf("version dispatch:  %6.3f ns\n", dispatched);
+	std::printf("current layout:    %6.3f ns\n", direct);
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+// -*- compile-command: "cd .. && make bench" -*-
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <fault_injection.hpp>
+
+FAULT_INJECTION_POINT_EX(bench, rate, "Rate limited point", -1);
+
+static constexpr unsigned int threads = 64;
+static constexpr double rate = 50.0;
+static constexpr auto duration = std::chrono::seconds(2);
+
+struct result_t
+{
+	unsigned long evaluated;
+	unsigned long injected;
+};
+
+static __attribute__((noinline)) int work(int value)
+{
+	return FAULT_INJECT_ERROR_CODE(bench, rate, value);
+}
+
+static result_t run(bool active)
+{
+	if (active) {
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(bench, rate), rate);
+		avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(bench, rate), avm::fault_injection::mode_t::rate_limited);
+	}
+
+	std::atomic<bool> stop{false};
+	std::vector<result_t> results(threads, result_t{0, 0});
+	std::vector<std::thread> workers;
+
+	for (unsigned int i = 0; i < threads; ++i) {
+		workers.emplace_back([&stop, &result = results[i]] {
+			unsigned long evaluated = 0;
+			unsigned long injected = 0;
+
+			while (!stop.load(std::memory_order_relaxed)) {
+				if (work(0) != 0) {
+					++injected;
+				}
+				++evaluated;
+			}
+
+			result = result_t{evaluated, injected};
+		});
+	}
+
+	std::this_thread::sleep_for(duration);
+	stop = true;
+
+	for (auto & worker : workers) {
+		worker.join();
+	}
+
+	avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(bench, rate));
+
+	result_t total{0, 0};
+	for (const auto & result : results) {
+		total.evaluated += result.evaluated;
+		total.injected += result.injected;
+	}
+
+	return total;
+}
+
+static void report(const char * title, const result_t & result)
+{
+	const double seconds = std::chrono::duration<double>(duration).count();
+
+	std::printf("%-14s %8.2f M evaluations/s, %6.1f injections/s\n", title,
+	            static_cast<double>(result.evaluated) / seconds / 1e6,
+	            static_cast<double>(result.injected) / seconds);
+}
+
+int main()
+{
+	std::printf("%u threads, rate limit %.0f/s\n", threads, rate);
+
+	report("inactive:", run(false));
+	report("rate limited:", run(true));
+
+	return 0;
+}
@@ -7,27 +7,97 @@
 #define FAULT_INJECTION_WRITE(var, value) (__atomic_store_n((var), (value), __ATOMIC_RELEASE), (value))
 #define FAULT_INJECTION_READ_V0(var) ((var).load(std::memory_order_acquire))
 #define FAULT_INJECTION_WRITE_V0(var, value) ((var).store(value, std::memory_order_release), (value))
+#define FAULT_INJECTION_FETCH_ADD(var, value) __atomic_add_fetch((var), (value), __ATOMIC_ACQ_REL)
+#define FAULT_INJECTION_FETCH_OR(var, value) __atomic_or_fetch((var), (value), __ATOMIC_ACQ_REL)
+#define FAULT_INJECTION_FETCH_AND(var, value) __atomic_and_fetch((var), (value), __ATOMIC_ACQ_REL)
+#define FAULT_INJECTION_CAS(var, expected, desired) __atomic_compare_exchange_n((var), (expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
 #else
 #define FAULT_INJECTION_READ(var) (var)
 #define FAULT_INJECTION_WRITE(var, value) (var) = (value)
 #define FAULT_INJECTION_READ_V0(var) (var)
 #define FAULT_INJECTION_WRITE_V0(var, value) (var) = (value)
+#define FAULT_INJECTION_FETCH_ADD(var, value) (*(var) += (value))
+#define FAULT_INJECTION_FETCH_OR(var, value) (*(var) |= (value))
+#define FAULT_INJECTION_FETCH_AND(var, value) (*(var) &= (value))
+#define FAULT_INJECTION_CAS(var, expected, desired) ((*(var) == *(expected)) ? ((*(var) = (desired)), true) : ((*(expected) = *(var)), false))
+#endif
+
+// Defined when runtime is used as shared library, it should be defined
+// for the library and all its clients
+#if defined(FAULT_INJECTION_SHARED)
+#define FAULT_INJECTION_API __attribute__((visibility("default")))
+#else
+#define FAULT_INJECTION_API __attribute__((visibility("hidden")))
 #endif
 
 #if FAULT_INJECTION_HAS_THREADS > 0
 #include <atomic>
 #endif
+#include <cstddef>
 #include <cstdint>
 #include <cassert>
+#include <cstring>
+#include <exception>
 #include <iterator>
+#include <memory>
+#include <system_error>
 #include <type_traits>
 #include <utility>
 
+#if defined(FAULT_INJECTION_SHARED)
+namespace avm::fault_injection
+{
+	struct point_t;
+	struct site_t;
+}
+
+// Bounds of points and sites sections of current module
+#if defined(__APPLE__)
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::point_t * fault_injection_section_start __asm("section$start$__DATA$__faults");
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::point_t * fault_injection_section_stop __asm("section$end$__DATA$__faults");
+#define FAULT_INJECTION_SECTION_START fault_injection_section_start
+#define FAULT_INJECTION_SECTION_STOP fault_injection_section_stop
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t * fault_injection_sites_start __asm("section$start$__DATA$__fault_sites");
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t * fault_injection_sites_stop __asm("section$end$__DATA$__fault_sites");
+#define FAULT_INJECTION_SITES_START fault_injection_sites_start
+#define FAULT_INJECTION_SITES_STOP fault_injection_sites_stop
+#elif defined(__linux__)
+// Weak references allow modules without points
+__attribute__((weak,visibility("hidden")))
+extern avm::fault_injection::point_t * __start___faults;
+__attribute__((weak,visibility("hidden")))
+extern avm::fault_injection::point_t * __stop___faults;
+#define FAULT_INJECTION_SECTION_START __start___faults
+#define FAULT_INJECTION_SECTION_STOP __stop___faults
+__attribute__((weak,visibility("hidden")))
+extern avm::fault_injection::site_t * __start___fault_sites;
+__attribute__((weak,visibility("hidden")))
+extern avm::fault_injection::site_t * __stop___fault_sites;
+#define FAULT_INJECTION_SITES_START __start___fault_sites
+#define FAULT_INJECTION_SITES_STOP __stop___fault_sites
+#else
+#error "Unsupported platform"
+#endif
+#endif
+
 namespace avm::fault_injection
 {
+	// Truncation of transfer size by FAULT_INJECT_IO_SIZE
+	enum class short_io_t: std::uint8_t {
+		one_byte,
+		fixed,
+		random
+	};
+
 	enum class mode_t: std::uint8_t {
 		multiple,
-		oneshot
+		oneshot,
+		// Supported by points of version 2 and greater
+		rate_limited
 	};
 
 	namespace v0
@@ -48,6 +118,35 @@ namespace avm::fault_injection
 		};
 	}
 
+	namespace v1
+	{
+		struct point_t {
+			const unsigned int version;
+			const char * const space;
+			const char * const name;
+			const char * const description;
+			int error_code;
+			bool active;
+			mode_t mode;
+		};
+	}
+
+	struct point_t;
+
+	namespace detail
+	{
+		struct group_t;
+		struct statistics_slot_t;
+		struct exception_t;
+		struct error_set_t;
+		struct cascade_table_t;
+		struct caller_filter_t;
+	}
+
+	// Hook receives context specified on installation and argument
+	// specified at injection site
+	using hook_t = void (*)(point_t & point, void * context, void * argument);
+
 	struct point_t
 	{
 		// This version is limited to range 1-255 to
@@ -61,7 +160,68 @@ namespace avm::fault_injection
 		mode_t mode;
 		union versions_t {
 			// Place future (greater than 1) version data here as structs
-		};
+			struct v2_t {
+				// Typed value guarded by sequence lock, odd
+				// sequence means update in progress
+				std::uint32_t payload_sequence;
+				std::uint32_t payload_type;
+				std::uint64_t payload[2];
+				// Runtime hook guarded by sequence lock
+				std::uint32_t hook_sequence;
+				hook_t hook;
+				void * hook_context;
+				// Rate limit in form of generic cell rate algorithm
+				// equivalent to token bucket: interval between tokens
+				// and burst tolerance in nanoseconds, theoretical
+				// arrival time of next token
+				std::uint64_t rate_interval;
+				std::uint64_t rate_tolerance;
+				std::uint64_t rate_tat;
+				// Epoch of registry journal when point was recorded
+				std::uint32_t journal_epoch;
+				// Group derived from space on registration and next
+				// point of the same group
+				detail::group_t * group;
+				point_t * group_next;
+				// Probability to skip perturbation scaled to 2^32,
+				// zero means perturb on every trigger
+				std::uint32_t perturbation_skip;
+				// Truncation of transfer size
+				short_io_t short_io;
+				std::uint64_t short_io_limit;
+				// Deadline of activation by coarse monotonic clock in
+				// nanoseconds, zero when activation doesn't expire
+				std::uint64_t expiry;
+				// Slot in statistics file when it is used
+				detail::statistics_slot_t * statistics;
+				// Exception installed at runtime, owned by runtime
+				// and immutable once published
+				detail::exception_t * exception;
+				// Error codes injected instead of error code of
+				// point, owned by runtime
+				detail::error_set_t * error_set;
+				// Triggers left to skip before injection and faults
+				// left to inject before deactivation, zero count is
+				// unlimited. Rearmed from window on activation.
+				std::uint32_t trigger_delay;
+				std::uint32_t trigger_count;
+				// Edges to points changed when point injects fault,
+				// owned by runtime
+				detail::cascade_table_t * cascade;
+				// Hashes of callers allowed to trigger point, owned by
+				// runtime
+				detail::caller_filter_t * caller_filter;
+				// Number of sites selected by activateSite(), other
+				// sites don't trigger when it is not zero
+				std::uint32_t selected_sites;
+				// Effective switch checked by injection macros: bit
+				// of point activation and bit of active group
+				std::uint8_t enabled;
+				// Trigger window set by setTriggerWindow()
+				std::uint32_t window_delay;
+				std::uint32_t window_count;
+			} v2;
+		} versions;
 	};
 
 	namespace detail
@@ -75,8 +235,133 @@ namespace avm::fault_injection
 		};
 	}
 
+	// Record of injection macro expansion collected in section like
+	// points, counters are updated only for enabled point
+	struct site_t
+	{
+		point_t * const point;
+		const char * const file;
+		const unsigned int line;
+		const char * const function;
+		std::uint64_t evaluated;
+		std::uint64_t triggered;
+		bool selected;
+	};
+
+	namespace detail
+	{
+		template<std::size_t N>
+		struct function_name_t
+		{
+			char chars[N];
+		};
+
+		constexpr bool matchAt(const char * signature, std::size_t length, std::size_t position, const char * prefix)
+		{
+			for (std::size_t i = 0; prefix[i] != '\0'; ++i) {
+				if ((position + i >= length) || (signature[position + i] != prefix[i])) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Position of bracket opening the one closed before `end`
+		constexpr std::size_t openingBracket(const char * signature, std::size_t end, char open, char close)
+		{
+			int depth = 0;
+
+			while (end > 0) {
+				--end;
+				if (signature[end] == close) {
+					++depth;
+				} else if ((signature[end] == open) && (--depth == 0)) {
+					return end;
+				}
+			}
+
+			return 0;
+		}
+
+		// Unqualified name of function enclosing lambda as __func__
+		// gives it, signature is __PRETTY_FUNCTION__ of lambda
+		// (e.g. "ns::read(int)::<lambda()>" by GCC or
+		// "auto ns::read(int)::(anonymous class)::operator()() const"
+		// by Clang). Lambda outside function gets empty name.
+		template<std::size_t N>
+		constexpr function_name_t<N> enclosingFunction(const char (&signature)[N])
+		{
+			function_name_t<N> result{};
+			const std::size_t length = N - 1;
+
+			std::size_t end = length;
+			for (std::size_t i = 0; i < length; ++i) {
+				if (matchAt(signature, length, i, "::<lambda") || matchAt(signature, length, i, "::(")) {
+					end = i;
+				}
+			}
+
+			if (end == length) {
+				return result;
+			}
+
+			// Skip qualifiers, parameters, ABI tags and template
+			// arguments of enclosing function
+			while ((end > 0) && (signature[end - 1] != ')')) {
+				--end;
+			}
+			end = openingBracket(signature, end, '(', ')');
+			while ((end > 0) && (signature[end - 1] == ']')) {
+				end = openingBracket(signature, end, '[', ']');
+			}
+			if ((end > 0) && (signature[end - 1] == '>')) {
+				end = openingBracket(signature, end, '<', '>');
+			}
+
+			std::size_t start = end;
+			while ((start > 0) && (signature[start - 1] != ':') && (signature[start - 1] != ' ')) {
+				--start;
+			}
+
+			for (std::size_t i = start; i < end; ++i) {
+				result.chars[i - start] = signature[i];
+			}
+
+			return result;
+		}
+
+		struct module_sites_t
+		{
+			module_sites_t * next;
+			avm::fault_injection::site_t ** const begin;
+			avm::fault_injection::site_t ** const end;
+			bool registered;
+		};
+
+		// Bits of point_t::versions_t::v2_t::enabled
+		constexpr std::uint8_t enabled_point = 1;
+		constexpr std::uint8_t enabled_group = 2;
+
+		// Node of group tree built from spaces split by "::"
+		struct group_t
+		{
+			// Full path of group, not null terminated
+			const char * name;
+			std::size_t length;
+			group_t * parent;
+			group_t * child;
+			group_t * sibling;
+			point_t * points;
+			// Switch of group itself and effective state including
+			// parents propagated to its points
+			bool enabled;
+			bool active;
+		};
+	}
+
 
-#define FAULT_INJECT_POINT_VERSION       1
+#define FAULT_INJECT_POINT_VERSION       2
 #define FAULT_INJECT_MAX_POINT_VERSION 255
 
 #if (FAULT_INJECTIONS_ENABLED > 0) || (FAULT_INJECTIONS_DEFINITIONS > 0)
@@ -89,13 +374,13 @@ namespace avm::fault_injection
 #if defined(__APPLE__)
 #define FAULT_INJECTION_POINT_EX(space, name, description, error_code)	  \
 	namespace space { \
-		::avm::fault_injection::point_t fault_injection_point_##name __attribute__((used)) = { FAULT_INJECT_POINT_VERSION, #space, #name, description, error_code, false, ::avm::fault_injection::mode_t::multiple }; \
+		::avm::fault_injection::point_t fault_injection_point_##name __attribute__((used)) = { FAULT_INJECT_POINT_VERSION, #space, #name, description, error_code, false, ::avm::fault_injection::mode_t::multiple, {} }; \
 		static ::avm::fault_injection::point_t * fault_injection_point_##name##_ptr __attribute__((used,section("__DATA,__faults"))) = &FAULT_INJECTION_POINT_REF(space, name); \
 	}
 #elif defined(__linux__)
 #define FAULT_INJECTION_POINT_EX(space, name, description, error_code)	  \
 	namespace space { \
-		::avm::fault_injection::point_t fault_injection_point_##name __attribute__((used)) = { FAULT_INJECT_POINT_VERSION, #space, #name, description, error_code, false, ::avm::fault_injection::mode_t::multiple }; \
+		::avm::fault_injection::point_t fault_injection_point_##name __attribute__((used)) = { FAULT_INJECT_POINT_VERSION, #space, #name, description, error_code, false, ::avm::fault_injection::mode_t::multiple, {} }; \
 		static ::avm::fault_injection::point_t * fault_injection_point_##name##_ptr __attribute__((used,section("__faults"))) = &FAULT_INJECTION_POINT_REF(space, name); \
 	}
 #else
@@ -116,60 +401,341 @@ namespace avm::fault_injection
 
 #define FAULT_INJECTION_POINT(space, name, description)	FAULT_INJECTION_POINT_EX(space, name, description, 0)
 
+// Injection can be turned off for a space at compile time while its
+// points stay defined: macro FAULT_INJECTION_SPACE_<space> is defined
+// as FAULT_INJECTION_OFF or FAULT_INJECTION_ON. Nested spaces follow
+// their top level space, spaces without the macro use
+// FAULT_INJECTION_SPACES_DEFAULT. The macros can be kept in header
+// (possibly generated) named by FAULT_INJECTION_SPACES_CONFIG.
+#if defined(FAULT_INJECTION_SPACES_CONFIG)
+#include FAULT_INJECTION_SPACES_CONFIG
+#endif
+
+#if !defined(FAULT_INJECTION_SPACES_DEFAULT)
+#define FAULT_INJECTION_SPACES_DEFAULT 1
+#endif
+
+#define FAULT_INJECTION_ON ~, 1,
+#define FAULT_INJECTION_OFF ~, 0,
+#define FAULT_INJECTION_SECOND(first, second, ...) second
+#define FAULT_INJECTION_SECOND_EXPANDED(...) FAULT_INJECTION_SECOND(__VA_ARGS__)
+
 #if FAULT_INJECTIONS_ENABLED > 0
 
+// Kept for backward compatibility, macros below use trigger()
 #define FAULT_INJECTION_ONESHOT(space, name) ((::avm::fault_injection::getMode(FAULT_INJECTION_POINT_REF(space, name)) == ::avm::fault_injection::mode_t::multiple) \
 			? true \
 			: (::avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(space, name)), false))
 
-#define FAULT_INJECT_ERROR_CODE_IF(space, name, condition, action) ((::avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(space, name)) && (condition)) \
-			? (FAULT_INJECTION_ONESHOT(space, name), ::avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(space, name))) \
+#if defined(__APPLE__)
+#define FAULT_INJECTION_SITES_SECTION "__DATA,__fault_sites"
+#elif defined(__linux__)
+#define FAULT_INJECTION_SITES_SECTION "__fault_sites"
+#else
+#error "Unsupported platform"
+#endif
+
+// Address of static site record of macro expansion, it is evaluated
+// only when point is enabled. Record is held by immediately invoked
+// lambda so macro is standard expression usable outside functions,
+// name of enclosing function is taken from signature of lambda.
+#define FAULT_INJECTION_SITE(space, name) ([]() -> ::avm::fault_injection::site_t * { \
+		static constexpr auto fault_injection_function = ::avm::fault_injection::detail::enclosingFunction(__PRETTY_FUNCTION__); \
+		static ::avm::fault_injection::site_t fault_injection_site = { &FAULT_INJECTION_POINT_REF(space, name), __FILE__, __LINE__, fault_injection_function.chars, 0, 0, false }; \
+		static ::avm::fault_injection::site_t * fault_injection_site_ptr __attribute__((used,section(FAULT_INJECTION_SITES_SECTION))) = &fault_injection_site; \
+		return &fault_injection_site; \
+	}())
+
+#define FAULT_INJECTION_TRIGGERED(space, name, condition) (__builtin_expect(::avm::fault_injection::detail::current::isEnabled(FAULT_INJECTION_POINT_REF(space, name)), 0) && (condition) \
+			&& ::avm::fault_injection::trigger(FAULT_INJECTION_POINT_REF(space, name), FAULT_INJECTION_SITE(space, name)))
+
+#define FAULT_INJECT_ERROR_CODE_IF_ON(space, name, condition, action) (FAULT_INJECTION_TRIGGERED(space, name, condition) \
+			? ::avm::fault_injection::detail::current::injectErrorCode(FAULT_INJECTION_POINT_REF(space, name)) \
+			: (action))
+
+#define FAULT_INJECT_ERRNO_IF_EX_ON(space, name, condition, action, result) (FAULT_INJECTION_TRIGGERED(space, name, condition) \
+			? ((errno = ::avm::fault_injection::detail::current::injectErrorCode(FAULT_INJECTION_POINT_REF(space, name))), (result)) \
 			: (action))
 
-#define FAULT_INJECT_ERRNO_IF_EX(space, name, condition, action, result) ((::avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(space, name)) && (condition)) \
-			? (FAULT_INJECTION_ONESHOT(space, name), (errno = ::avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(space, name))), (result)) \
+#define FAULT_INJECT_VALUE_IF_ON(space, name, condition, action) (FAULT_INJECTION_TRIGGERED(space, name, condition) \
+			? ::avm::fault_injection::getValue<std::decay_t<decltype(action)>>(FAULT_INJECTION_POINT_REF(space, name)) \
 			: (action))
-#define FAULT_INJECT_EXCEPTION_IF(space, name, condition, exception) do { \
-		if (::avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(space, name)) && (condition)) { \
-			static_cast<void>(FAULT_INJECTION_ONESHOT(space, name)); \
+
+// Error channel without exceptions, result of action is constructed
+// from std::error_code with error code of point in generic category
+#define FAULT_INJECT_ERROR_IF_ON(space, name, condition, action) (FAULT_INJECTION_TRIGGERED(space, name, condition) \
+			? static_cast<std::decay_t<decltype(action)>>(std::error_code(::avm::fault_injection::detail::current::injectErrorCode(FAULT_INJECTION_POINT_REF(space, name)), std::generic_category())) \
+			: (action))
+
+#if defined(__cpp_exceptions)
+#define FAULT_INJECT_EXCEPTION_IF_ON(space, name, condition, exception) do { \
+		if (FAULT_INJECTION_TRIGGERED(space, name, condition)) { \
+			::avm::fault_injection::detail::rethrowException(FAULT_INJECTION_POINT_REF(space, name)); \
 			throw (exception); \
 		} \
 	} while (false)
+#else
+#define FAULT_INJECT_EXCEPTION_IF_ON(space, name, condition, exception) \
+	static_assert(sizeof(exception) == 0, "FAULT_INJECT_EXCEPTION requires exceptions, use FAULT_INJECT_ERROR")
+#endif
 
-#define FAULT_INJECT_ACTION(space, name, action) do {	  \
-	if (::avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(space, name))) { \
-		static_cast<void>(FAULT_INJECTION_ONESHOT(space, name)); \
+#define FAULT_INJECT_ACTION_ON(space, name, action) do {	  \
+	if (FAULT_INJECTION_TRIGGERED(space, name, true)) { \
 		action; \
 	} \
 } while (false)
 
+#define FAULT_INJECT_HOOK_IF_ON(space, name, condition, argument) do {	  \
+	if (FAULT_INJECTION_TRIGGERED(space, name, condition)) { \
+		::avm::fault_injection::callHook(FAULT_INJECTION_POINT_REF(space, name), (argument)); \
+	} \
+} while (false)
+
+#define FAULT_INJECT_IO_SIZE_IF_ON(space, name, condition, size) ::avm::fault_injection::detail::shortSize(FAULT_INJECTION_TRIGGERED(space, name, condition), \
+			FAULT_INJECTION_POINT_REF(space, name), (size))
+
+#define FAULT_INJECT_PERTURBATION_IF_ON(space, name, condition) do {	  \
+	if (FAULT_INJECTION_TRIGGERED(space, name, condition)) { \
+		::avm::fault_injection::detail::perturb(FAULT_INJECTION_POINT_REF(space, name)); \
+	} \
+} while (false)
+
+#define FAULT_INJECTION_SPACE_ENABLED(space) FAULT_INJECTION_SECOND_EXPANDED(FAULT_INJECTION_SPACE_##space, FAULT_INJECTION_SPACES_DEFAULT, ~)
+
 #else
 
-#define FAULT_INJECT_ERROR_CODE_IF(space, name, condition, action) (action)
-#define FAULT_INJECT_ERRNO_IF_EX(space, name, condition, action, result) (action)
-#define FAULT_INJECT_EXCEPTION_IF(space, name, condition, exception)
-#define FAULT_INJECT_ACTION(space, name, action)
+#define FAULT_INJECTION_SPACE_ENABLED(space) 0
 
 #endif
 
+// Expansions for disabled build and disabled spaces
+#define FAULT_INJECT_ERROR_CODE_IF_OFF(space, name, condition, action) (action)
+#define FAULT_INJECT_ERRNO_IF_EX_OFF(space, name, condition, action, result) (action)
+#define FAULT_INJECT_VALUE_IF_OFF(space, name, condition, action) (action)
+#define FAULT_INJECT_ERROR_IF_OFF(space, name, condition, action) (action)
+#define FAULT_INJECT_EXCEPTION_IF_OFF(space, name, condition, exception)
+#define FAULT_INJECT_ACTION_OFF(space, name, action)
+#define FAULT_INJECT_HOOK_IF_OFF(space, name, condition, argument)
+#define FAULT_INJECT_PERTURBATION_IF_OFF(space, name, condition)
+#define FAULT_INJECT_IO_SIZE_IF_OFF(space, name, condition, size) (size)
+
+#define FAULT_INJECTION_SELECT_0(on, off) off
+#define FAULT_INJECTION_SELECT_1(on, off) on
+#define FAULT_INJECTION_SELECT_EXPANDED(enabled) FAULT_INJECTION_SELECT_##enabled
+#define FAULT_INJECTION_SELECT(enabled) FAULT_INJECTION_SELECT_EXPANDED(enabled)
+#define FAULT_INJECTION_IF_SPACE(space, on, off) FAULT_INJECTION_SELECT(FAULT_INJECTION_SPACE_ENABLED(space))(on, off)
+
+#define FAULT_INJECT_ERROR_CODE_IF(space, name, condition, action) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_ERROR_CODE_IF_ON, FAULT_INJECT_ERROR_CODE_IF_OFF)(space, name, condition, action)
+#define FAULT_INJECT_ERRNO_IF_EX(space, name, condition, action, result) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_ERRNO_IF_EX_ON, FAULT_INJECT_ERRNO_IF_EX_OFF)(space, name, condition, action, result)
+#define FAULT_INJECT_VALUE_IF(space, name, condition, action) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_VALUE_IF_ON, FAULT_INJECT_VALUE_IF_OFF)(space, name, condition, action)
+#define FAULT_INJECT_ERROR_IF(space, name, condition, action) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_ERROR_IF_ON, FAULT_INJECT_ERROR_IF_OFF)(space, name, condition, action)
+#define FAULT_INJECT_EXCEPTION_IF(space, name, condition, exception) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_EXCEPTION_IF_ON, FAULT_INJECT_EXCEPTION_IF_OFF)(space, name, condition, exception)
+#define FAULT_INJECT_ACTION(space, name, action) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_ACTION_ON, FAULT_INJECT_ACTION_OFF)(space, name, action)
+#define FAULT_INJECT_HOOK_IF(space, name, condition, argument) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_HOOK_IF_ON, FAULT_INJECT_HOOK_IF_OFF)(space, name, condition, argument)
+#define FAULT_INJECT_PERTURBATION_IF(space, name, condition) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_PERTURBATION_IF_ON, FAULT_INJECT_PERTURBATION_IF_OFF)(space, name, condition)
+#define FAULT_INJECT_IO_SIZE_IF(space, name, condition, size) \
+	FAULT_INJECTION_IF_SPACE(space, FAULT_INJECT_IO_SIZE_IF_ON, FAULT_INJECT_IO_SIZE_IF_OFF)(space, name, condition, size)
+
 #define FAULT_INJECT_ERROR_CODE(space, name, action) FAULT_INJECT_ERROR_CODE_IF(space, name, true, action)
 #define FAULT_INJECT_ERRNO(space, name, action) FAULT_INJECT_ERRNO_IF_EX(space, name, true, action, -1)
 #define FAULT_INJECT_ERRNO_EX(space, name, action, result) FAULT_INJECT_ERRNO_IF_EX(space, name, true, action, result)
 #define FAULT_INJECT_ERRNO_IF(space, name, condition, action) FAULT_INJECT_ERRNO_IF_EX(space, name, condition, action, -1)
+#define FAULT_INJECT_VALUE(space, name, action) FAULT_INJECT_VALUE_IF(space, name, true, action)
+#define FAULT_INJECT_ERROR(space, name, action) FAULT_INJECT_ERROR_IF(space, name, true, action)
 #define FAULT_INJECT_EXCEPTION(space, name, exception) FAULT_INJECT_EXCEPTION_IF(space, name, true, exception)
+#define FAULT_INJECT_HOOK(space, name, argument) FAULT_INJECT_HOOK_IF(space, name, true, argument)
+#define FAULT_INJECT_PERTURBATION(space, name) FAULT_INJECT_PERTURBATION_IF(space, name, true)
+#define FAULT_INJECT_IO_SIZE(space, name, size) FAULT_INJECT_IO_SIZE_IF(space, name, true, size)
+
+#if defined(FAULT_INJECTION_SHARED)
+	FAULT_INJECTION_API
+	void registerModuleImpl(detail::module_points_t * points);
+
+	FAULT_INJECTION_API
+	void registerSitesImpl(detail::module_sites_t * sites);
 
+	// Every shared object registers its own section in registry of
+	// shared runtime
 	__attribute__((visibility("hidden")))
+	inline void registerModule()
+	{
+		static detail::module_points_t module = {
+			nullptr,
+			&FAULT_INJECTION_SECTION_START,
+			&FAULT_INJECTION_SECTION_STOP,
+			false,
+		};
+
+		static detail::module_sites_t sites = {
+			nullptr,
+			&FAULT_INJECTION_SITES_START,
+			&FAULT_INJECTION_SITES_STOP,
+			false,
+		};
+
+		if (!module.registered && (module.begin != nullptr)) {
+			registerModuleImpl(&module);
+		}
+		if (!sites.registered && (sites.begin != nullptr)) {
+			registerSitesImpl(&sites);
+		}
+	}
+#else
+	FAULT_INJECTION_API
 	void registerModule();
+#endif
 
-	__attribute__((visibility("hidden")))
+	FAULT_INJECTION_API
 	point_t * find(const char * space, const char * name);
 
+	struct point_name_t
+	{
+		const char * space;
+		const char * name;
+	};
+
+	// Lookup many points during single pass over registry, result
+	// receives nullptr for missing points
+	FAULT_INJECTION_API
+	void findAll(const point_name_t * names, std::size_t count, point_t ** result);
+
+	namespace detail
+	{
+		// Journal of changed points used by registry snapshot, only
+		// one journal can be started at a time. Stop returns number
+		// of recorded points which can exceed capacity.
+		FAULT_INJECTION_API
+		bool startJournal(point_t ** entries, std::uint32_t capacity);
+
+		FAULT_INJECTION_API
+		std::uint32_t stopJournal();
+
+		FAULT_INJECTION_API
+		void journal(point_t & point);
+
+		FAULT_INJECTION_API
+		group_t * findGroup(const char * group);
+
+		template<typename Function>
+		__attribute__((visibility("hidden")))
+		inline void forEachGroupPoint(group_t & group, Function & function)
+		{
+			for (point_t * point = group.points; point != nullptr; point = point->versions.v2.group_next) {
+				function(*point);
+			}
+
+			for (group_t * child = group.child; child != nullptr; child = child->sibling) {
+				forEachGroupPoint(*child, function);
+			}
+		}
+	}
+
+	// Group switch enables all points of group and its descendants
+	// (e.g. "storage" enables "storage::disk") without changing state
+	// of points. Returns false for unknown group.
+	FAULT_INJECTION_API
+	bool activateGroup(const char * group);
+
+	FAULT_INJECTION_API
+	bool deactivateGroup(const char * group);
+
+	__attribute__((visibility("hidden")))
+	inline bool isGroupActive(const char * group)
+	{
+		if (detail::group_t * item = detail::findGroup(group)) {
+			return FAULT_INJECTION_READ(&item->active);
+		}
+
+		return false;
+	}
+
+	// Visits points of group and its descendants without scanning
+	// the registry
+	template<typename Function>
+	__attribute__((visibility("hidden")))
+	inline void forEachGroupPoint(const char * group, Function function)
+	{
+		if (detail::group_t * item = detail::findGroup(group)) {
+			detail::forEachGroupPoint(*item, function);
+		}
+	}
+
 	__attribute__((visibility("hidden")))
 	inline unsigned int getPointVersion(const point_t & point)
 	{
 		return (point.version < FAULT_INJECT_MAX_POINT_VERSION) ? point.version : 0;
 	}
 
+	namespace detail
+	{
+		enum class session_t: std::uint8_t {
+			none,
+			record,
+			replay,
+			fuzz
+		};
+
+		FAULT_INJECTION_API
+		session_t getSession();
+
+		// Next error code from error set of point or chosen by
+		// fuzzer for the last hit
+		FAULT_INJECTION_API
+		int nextErrorCode(point_t & point);
+	}
+
+	namespace detail::current
+	{
+		// Points referenced by injection macros are defined in the
+		// same module so they always have current layout and version
+		// dispatch is not needed. Points from registry can have old
+		// layout and should use generic accessors.
+		__attribute__((visibility("hidden")))
+		inline bool isActive(const point_t & point)
+		{
+			return FAULT_INJECTION_READ(&point.active);
+		}
+
+		// Single load for inactive point, group switch is propagated
+		// to points of group
+		__attribute__((visibility("hidden")))
+		inline bool isEnabled(const point_t & point)
+		{
+			return FAULT_INJECTION_READ(&point.versions.v2.enabled) != 0;
+		}
+
+		__attribute__((visibility("hidden")))
+		inline int getErrorCode(const point_t & point)
+		{
+			return FAULT_INJECTION_READ(&point.error_code);
+		}
+
+		// Error code of triggered point used by injection macros
+		__attribute__((visibility("hidden")))
+		inline int injectErrorCode(point_t & point)
+		{
+			if ((FAULT_INJECTION_READ(&point.versions.v2.error_set) != nullptr) || (getSession() == session_t::fuzz)) {
+				return nextErrorCode(point);
+			}
+
+			return getErrorCode(point);
+		}
+
+		__attribute__((visibility("hidden")))
+		inline mode_t getMode(const point_t & point)
+		{
+			return static_cast<mode_t>(FAULT_INJECTION_READ(reinterpret_cast<const std::underlying_type_t<mode_t> *>(&point.mode)));
+		}
+	}
+
 	__attribute__((visibility("hidden")))
 	inline const char * getSpace(const point_t & point)
 	{
@@ -196,6 +762,7 @@ namespace avm::fault_injection
 			return FAULT_INJECTION_READ_V0(reinterpret_cast<const v0::point_t &>(point).active);
 
 		case 1:
+		case 2:
 			return FAULT_INJECTION_READ(&point.active);
 
 		default:
@@ -219,20 +786,58 @@ namespace avm::fault_injection
 		return false;
 	}
 
+	namespace detail
+	{
+		// Removes selection of sites made by activateSite()
+		FAULT_INJECTION_API
+		void clearSites(point_t & point);
+
+		// Activation which keeps selection of sites
+		__attribute__((visibility("hidden")))
+		inline void enable(point_t & point, mode_t mode)
+		{
+			journal(point);
+
+			if ((getPointVersion(point) < 2) && (mode > mode_t::oneshot)) {
+				// Old points support only multiple and one-shot modes
+				mode = mode_t::multiple;
+			}
+
+			switch (getPointVersion(point)) {
+			case 0:
+				FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).mode, mode);
+				FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).active, true);
+				break;
+
+			case 1:
+				FAULT_INJECTION_WRITE(reinterpret_cast<std::underlying_type_t<mode_t> *>(&point.mode), static_cast<std::underlying_type_t<mode_t>>(mode));
+				FAULT_INJECTION_WRITE(&point.active, true);
+				break;
+
+			case 2:
+				if (!FAULT_INJECTION_READ(&point.active)) {
+					// Every activation gets full trigger window
+					FAULT_INJECTION_WRITE(&point.versions.v2.trigger_delay, FAULT_INJECTION_READ(&point.versions.v2.window_delay));
+					FAULT_INJECTION_WRITE(&point.versions.v2.trigger_count, FAULT_INJECTION_READ(&point.versions.v2.window_count));
+				}
+				FAULT_INJECTION_WRITE(reinterpret_cast<std::underlying_type_t<mode_t> *>(&point.mode), static_cast<std::underlying_type_t<mode_t>>(mode));
+				FAULT_INJECTION_WRITE(&point.active, true);
+				FAULT_INJECTION_FETCH_OR(&point.versions.v2.enabled, detail::enabled_point);
+				break;
+			}
+		}
+	}
+
+	// Activation applies to all sites of point, so it removes
+	// selection of sites
 	__attribute__((visibility("hidden")))
 	inline void activate(point_t & point, mode_t mode = mode_t::multiple)
 	{
-		switch (getPointVersion(point)) {
-		case 0:
-			FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).mode, mode);
-			FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).active, true);
-			break;
-
-		case 1:
-			FAULT_INJECTION_WRITE(reinterpret_cast<std::underlying_type_t<mode_t> *>(&point.mode), static_cast<std::underlying_type_t<mode_t>>(mode));
-			FAULT_INJECTION_WRITE(&point.active, true);
-			break;
+		if ((getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.selected_sites) != 0)) {
+			detail::clearSites(point);
 		}
+
+		detail::enable(point, mode);
 	}
 
 	__attribute__((visibility("hidden")))
@@ -250,6 +855,8 @@ namespace avm::fault_injection
 	__attribute__((visibility("hidden")))
 	inline void deactivate(point_t & point)
 	{
+		detail::journal(point);
+
 		switch (getPointVersion(point)) {
 		case 0:
 			FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).active, false);
@@ -258,6 +865,17 @@ namespace avm::fault_injection
 		case 1:
 			FAULT_INJECTION_WRITE(&point.active, false);
 			break;
+
+		case 2:
+			FAULT_INJECTION_WRITE(&point.active, false);
+			FAULT_INJECTION_FETCH_AND(&point.versions.v2.enabled, static_cast<std::uint8_t>(~detail::enabled_point));
+			// Deadline and selection of sites belong to ended
+			// activation
+			FAULT_INJECTION_WRITE(&point.versions.v2.expiry, std::uint64_t{0});
+			if (FAULT_INJECTION_READ(&point.versions.v2.selected_sites) != 0) {
+				detail::clearSites(point);
+			}
+			break;
 		}
 	}
 
@@ -276,12 +894,15 @@ namespace avm::fault_injection
 	__attribute__((visibility("hidden")))
 	inline void setErrorCode(point_t & point, int error = 0)
 	{
+		detail::journal(point);
+
 		switch (getPointVersion(point)) {
 		case 0:
 			FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).error_code, error);
 			break;
 
 		case 1:
+		case 2:
 			FAULT_INJECTION_WRITE(&point.error_code, error);
 			break;
 		}
@@ -307,6 +928,7 @@ namespace avm::fault_injection
 			return FAULT_INJECTION_READ_V0(reinterpret_cast<const v0::point_t &>(point).error_code);
 
 		case 1:
+		case 2:
 			return FAULT_INJECTION_READ(&point.error_code);
 
 		default:
@@ -338,6 +960,7 @@ namespace avm::fault_injection
 			return FAULT_INJECTION_READ_V0(reinterpret_cast<const v0::point_t &>(point).mode);
 
 		case 1:
+		case 2:
 			return static_cast<mode_t>(FAULT_INJECTION_READ(reinterpret_cast<const std::underlying_type_t<mode_t> *>(&point.mode)));
 
 		default:
@@ -364,12 +987,20 @@ namespace avm::fault_injection
 	__attribute__((visibility("hidden")))
 	inline void setMode(point_t & point, mode_t mode)
 	{
+		detail::journal(point);
+
+		if ((getPointVersion(point) < 2) && (mode > mode_t::oneshot)) {
+			// Old points support only multiple and one-shot modes
+			mode = mode_t::multiple;
+		}
+
 		switch (getPointVersion(point)) {
 		case 0:
 			FAULT_INJECTION_WRITE_V0(reinterpret_cast<v0::point_t &>(point).mode, mode);
 			break;
 
 		case 1:
+		case 2:
 			FAULT_INJECTION_WRITE(reinterpret_cast<std::underlying_type_t<mode_t> *>(&point.mode), static_cast<std::underlying_type_t<mode_t>>(mode));
 			break;
 		}
@@ -388,43 +1019,1023 @@ namespace avm::fault_injection
 	{
 	}
 
-	class points_collection
+	namespace detail
 	{
-	public:
-		class iterator
-		{
-		public:
-			using iterator_category = std::forward_iterator_tag;
-			using difference_type   = std::ptrdiff_t;
-			using value_type        = point_t;
-			using pointer           = point_t *;
-			using reference         = point_t &;
+		FAULT_INJECTION_API
+		bool takeToken(point_t & point);
+
+		// Consumes delay of point, returns true if trigger is
+		// skipped
+		FAULT_INJECTION_API
+		bool takeDelay(point_t & point);
+
+		// Consumes count of point when fault is injected, returns
+		// false when count is exhausted
+		FAULT_INJECTION_API
+		bool takeCount(point_t & point);
+	}
 
-			reference operator *() const noexcept
-			{
-				assert(ptr_ != nullptr);
+	// Skip `delay` triggers of point and then inject `count` faults
+	// before deactivation, zero count is unlimited. Window applies to
+	// current activation and is rearmed by every activation of
+	// inactive point.
+	FAULT_INJECTION_API
+	void setTriggerWindow(point_t & point, std::uint32_t delay, std::uint32_t count);
 
-				return **ptr_;
-			}
+	__attribute__((visibility("hidden")))
+	inline void setTriggerWindow(const char * space, const char * name, std::uint32_t delay, std::uint32_t count)
+	{
+		if (point_t * point = find(space, name)) {
+			setTriggerWindow(*point, delay, count);
+		}
+	}
 
-			pointer operator ->() const noexcept
-			{
-				assert(ptr_ != nullptr);
+	__attribute__((visibility("hidden")))
+	inline void setTriggerWindow(std::nullptr_t, std::uint32_t, std::uint32_t)
+	{}
 
-				return *ptr_;
-			}
+	// Set rate for mode_t::rate_limited: at most `rate` triggers per
+	// second with bursts up to `burst` triggers. Zero rate disables
+	// triggering, infinite rate removes limit.
+	FAULT_INJECTION_API
+	void setRateLimit(point_t & point, double rate, std::uint32_t burst = 1);
 
-			iterator& operator ++()
-			{
-				if (ptr_ == nullptr) {
-					return *this;
-				}
+	__attribute__((visibility("hidden")))
+	inline void setRateLimit(const char * space, const char * name, double rate, std::uint32_t burst = 1)
+	{
+		if (point_t * point = find(space, name)) {
+			setRateLimit(*point, rate, burst);
+		}
+	}
 
-				do {
-					++ptr_;
-					if (ptr_ == module_->end) {
-						do {
-							module_ = module_->next;
+	__attribute__((visibility("hidden")))
+	inline void setRateLimit(std::nullptr_t, double, std::uint32_t = 1)
+	{}
+
+	namespace detail
+	{
+		// Hit is call of trigger() for point by thread, record
+		// stores hits which injected fault and replay injects fault
+		// only on stored hits
+		FAULT_INJECTION_API
+		bool recordHit(point_t & point, bool triggered);
+
+		FAULT_INJECTION_API
+		bool replayHit(point_t & point);
+
+		FAULT_INJECTION_API
+		bool fuzzHit(point_t & point);
+
+		__attribute__((visibility("hidden")))
+		inline bool decide(point_t & point)
+		{
+			if ((FAULT_INJECTION_READ(&point.versions.v2.trigger_delay) != 0) && takeDelay(point)) {
+				return false;
+			}
+
+			// Count is spent only by injected faults
+			const mode_t mode = current::getMode(point);
+			if ((mode == mode_t::rate_limited) && !takeToken(point)) {
+				return false;
+			}
+
+			if ((FAULT_INJECTION_READ(&point.versions.v2.trigger_count) != 0) && !takeCount(point)) {
+				return false;
+			}
+
+			if (mode == mode_t::oneshot) {
+				deactivate(point);
+			}
+
+			return true;
+		}
+	}
+
+	// Record hits which injected fault to compact binary file. Fails
+	// when another session is in progress.
+	FAULT_INJECTION_API
+	bool startRecording();
+
+	// Should be called when points are not evaluated by other
+	// threads, returns false when file can't be written
+	FAULT_INJECTION_API
+	bool stopRecording(const char * path);
+
+	// Inject faults exactly on hits from recorded file ignoring point
+	// mode, points should be enabled as during recording
+	FAULT_INJECTION_API
+	bool startReplay(const char * path);
+
+	FAULT_INJECTION_API
+	void stopReplay();
+
+	// Every hit of enabled point consumes bit of fuzzer input to
+	// decide whether to inject fault ignoring point mode, exhausted
+	// input doesn't inject. Calling it again only resets input so it
+	// is cheap to call on every fuzz iteration.
+	FAULT_INJECTION_API
+	bool startFuzzing(const std::uint8_t * data, std::size_t size);
+
+	FAULT_INJECTION_API
+	void stopFuzzing();
+
+	// Alternative error codes chosen by fuzzer input on injection in
+	// addition to error code of point, point itself is not changed
+	FAULT_INJECTION_API
+	void setFuzzErrorCodes(point_t & point, const int * codes, std::size_t count);
+
+	__attribute__((visibility("hidden")))
+	inline void setFuzzErrorCodes(const char * space, const char * name, const int * codes, std::size_t count)
+	{
+		if (point_t * point = find(space, name)) {
+			setFuzzErrorCodes(*point, codes, count);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setFuzzErrorCodes(std::nullptr_t, const int *, std::size_t)
+	{}
+
+	// Inject error codes in order instead of error code of point,
+	// sequence restarts when it is exhausted. Position is shared by
+	// all threads. Empty set restores error code of point.
+	FAULT_INJECTION_API
+	void setErrorSequence(point_t & point, const int * codes, std::size_t count);
+
+	__attribute__((visibility("hidden")))
+	inline void setErrorSequence(const char * space, const char * name, const int * codes, std::size_t count)
+	{
+		if (point_t * point = find(space, name)) {
+			setErrorSequence(*point, codes, count);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setErrorSequence(std::nullptr_t, const int *, std::size_t)
+	{}
+
+	// Inject error code sampled with relative weights on every trigger
+	FAULT_INJECTION_API
+	void setErrorWeights(point_t & point, const int * codes, const double * weights, std::size_t count);
+
+	__attribute__((visibility("hidden")))
+	inline void setErrorWeights(const char * space, const char * name, const int * codes, const double * weights, std::size_t count)
+	{
+		if (point_t * point = find(space, name)) {
+			setErrorWeights(*point, codes, weights, count);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setErrorWeights(std::nullptr_t, const int *, const double *, std::size_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void resetErrorSet(point_t & point)
+	{
+		setErrorSequence(point, nullptr, 0);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetErrorSet(const char * space, const char * name)
+	{
+		setErrorSequence(space, name, nullptr, 0);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetErrorSet(std::nullptr_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasErrorSet(const point_t & point)
+	{
+		return (getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.error_set) != nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasErrorSet(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			return hasErrorSet(*point);
+		}
+
+		return false;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasErrorSet(std::nullptr_t)
+	{
+		return false;
+	}
+
+	namespace detail
+	{
+		// Randomly yields, spins or moves thread to another CPU
+		FAULT_INJECTION_API
+		void perturb(point_t & point);
+	}
+
+	// Set probability (0-1) of perturbation on every trigger of point
+	// by FAULT_INJECT_PERTURBATION, it also scales spin duration
+	FAULT_INJECTION_API
+	void setPerturbation(point_t & point, double intensity);
+
+	__attribute__((visibility("hidden")))
+	inline void setPerturbation(const char * space, const char * name, double intensity)
+	{
+		if (point_t * point = find(space, name)) {
+			setPerturbation(*point, intensity);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setPerturbation(std::nullptr_t, double)
+	{}
+
+	// Perturbations of every kind made by all points, thread which
+	// can't be migrated yields instead
+	struct perturbation_counts_t
+	{
+		std::uint64_t yields;
+		std::uint64_t spins;
+		std::uint64_t migrations;
+	};
+
+	FAULT_INJECTION_API
+	perturbation_counts_t getPerturbationCounts();
+
+	namespace detail
+	{
+		// Returns size from 1 to size - 1 according to point policy
+		FAULT_INJECTION_API
+		std::size_t shortSize(point_t & point, std::size_t size);
+
+		template<typename Size>
+		__attribute__((visibility("hidden")))
+		inline Size shortSize(bool triggered, point_t & point, Size size)
+		{
+			if (!triggered || (size <= 1)) {
+				return size;
+			}
+
+			return static_cast<Size>(shortSize(point, static_cast<std::size_t>(size)));
+		}
+	}
+
+	// Set truncation of transfer size by FAULT_INJECT_IO_SIZE: to one
+	// byte, to `limit` bytes or to random size
+	FAULT_INJECTION_API
+	void setShortIo(point_t & point, short_io_t policy, std::size_t limit = 1);
+
+	__attribute__((visibility("hidden")))
+	inline void setShortIo(const char * space, const char * name, short_io_t policy, std::size_t limit = 1)
+	{
+		if (point_t * point = find(space, name)) {
+			setShortIo(*point, policy, limit);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setShortIo(std::nullptr_t, short_io_t, std::size_t = 1)
+	{}
+
+	namespace detail
+	{
+		// Deactivates point once deadline has passed, returns true
+		// if point is expired
+		FAULT_INJECTION_API
+		bool isExpired(point_t & point);
+	}
+
+	// Set time to live of point activation in seconds, point is
+	// deactivated by first trigger after deadline. Infinite value
+	// removes expiry, deactivation removes it too.
+	FAULT_INJECTION_API
+	void setTtl(point_t & point, double ttl);
+
+	__attribute__((visibility("hidden")))
+	inline void setTtl(const char * space, const char * name, double ttl)
+	{
+		if (point_t * point = find(space, name)) {
+			setTtl(*point, ttl);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setTtl(std::nullptr_t, double)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void activateFor(point_t & point, double ttl, mode_t mode = mode_t::multiple)
+	{
+		setTtl(point, ttl);
+		activate(point, mode);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void activateFor(const char * space, const char * name, double ttl, mode_t mode = mode_t::multiple)
+	{
+		if (point_t * point = find(space, name)) {
+			activateFor(*point, ttl, mode);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void activateFor(std::nullptr_t, double, mode_t = mode_t::multiple)
+	{}
+
+	namespace detail
+	{
+		// Layout of statistics file in native byte order: header
+		// followed by slots of points
+		struct statistics_header_t
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t capacity;
+			std::uint32_t size;
+			std::uint32_t reserved;
+		};
+
+		struct statistics_slot_t
+		{
+			// Truncated null terminated strings
+			char space[64];
+			char name[64];
+			// Number of triggers evaluated for enabled point and
+			// number of injected faults
+			std::uint64_t evaluated;
+			std::uint64_t triggered;
+			// Wall clock time of last injected fault in nanoseconds
+			// since epoch
+			std::uint64_t last_triggered;
+		};
+
+		constexpr char statistics_magic[8] = {'F', 'I', 'S', 'T', 'A', 'T', 'S', '\0'};
+		constexpr std::uint32_t statistics_version = 1;
+
+		FAULT_INJECTION_API
+		void count(statistics_slot_t & slot, bool triggered);
+	}
+
+	// Keep statistics of points in memory mapped file which survives
+	// crash of process, `capacity` limits number of points. Returns
+	// false when file can't be created or statistics are already
+	// kept.
+	FAULT_INJECTION_API
+	bool startStatistics(const char * path, std::uint32_t capacity = 1024);
+
+	// Should be called when points are not evaluated by other threads
+	FAULT_INJECTION_API
+	void stopStatistics();
+
+	namespace detail
+	{
+		// Checks callers of function with injection site, `frame`
+		// is frame of trigger() called by that function
+		FAULT_INJECTION_API
+		bool matchCaller(const point_t & point, const void * frame);
+	}
+
+	// Hash of `depth` return addresses starting with return address of
+	// function calling it, hash of depth 1 is the return address
+	// itself. Called in function with injection site it gives the key
+	// of its current callers for setCallerFilter(). Requires code
+	// built with frame pointers.
+	FAULT_INJECTION_API
+	__attribute__((noinline))
+	std::uint64_t getCallerHash(unsigned int depth = 1);
+
+	// Restrict triggering of point to callers of function with
+	// injection site whose hash of `depth` return addresses is one of
+	// `hashes`, empty set removes filter
+	FAULT_INJECTION_API
+	void setCallerFilter(point_t & point, unsigned int depth, const std::uint64_t * hashes, std::size_t count);
+
+	__attribute__((visibility("hidden")))
+	inline void setCallerFilter(const char * space, const char * name, unsigned int depth, const std::uint64_t * hashes, std::size_t count)
+	{
+		if (point_t * point = find(space, name)) {
+			setCallerFilter(*point, depth, hashes, count);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setCallerFilter(std::nullptr_t, unsigned int, const std::uint64_t *, std::size_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void resetCallerFilter(point_t & point)
+	{
+		setCallerFilter(point, 1, nullptr, 0);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetCallerFilter(const char * space, const char * name)
+	{
+		setCallerFilter(space, name, 1, nullptr, 0);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetCallerFilter(std::nullptr_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasCallerFilter(const point_t & point)
+	{
+		return (getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.caller_filter) != nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasCallerFilter(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			return hasCallerFilter(*point);
+		}
+
+		return false;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasCallerFilter(std::nullptr_t)
+	{
+		return false;
+	}
+
+	enum class cascade_action_t: std::uint8_t {
+		activate,
+		deactivate,
+		set_error_code
+	};
+
+	// Edge of trigger graph applied to target point when source point
+	// injects fault
+	struct cascade_t
+	{
+		cascade_action_t action = cascade_action_t::activate;
+		// Mode of activated target
+		mode_t mode = mode_t::multiple;
+		// Triggers of activated target skipped before it injects
+		std::uint32_t delay = 0;
+		// Faults injected by activated target before it deactivates,
+		// zero is unlimited
+		std::uint32_t count = 0;
+		// Error code for cascade_action_t::set_error_code
+		int error_code = 0;
+	};
+
+	namespace detail
+	{
+		// Applies edges of point, called only when fault is injected
+		FAULT_INJECTION_API
+		void cascade(point_t & point);
+	}
+
+	// Add edge from `source` to `target`, both points should have
+	// version 2 or greater. Returns false if edge can't be added.
+	FAULT_INJECTION_API
+	bool addCascade(point_t & source, point_t & target, const cascade_t & edge);
+
+	__attribute__((visibility("hidden")))
+	inline bool addCascade(const char * source_space, const char * source_name, const char * target_space, const char * target_name, const cascade_t & edge)
+	{
+		point_t * source = find(source_space, source_name);
+		point_t * target = find(target_space, target_name);
+
+		return (source != nullptr) && (target != nullptr) && addCascade(*source, *target, edge);
+	}
+
+	// Remove all edges of `source`
+	FAULT_INJECTION_API
+	void clearCascade(point_t & source);
+
+	__attribute__((visibility("hidden")))
+	inline void clearCascade(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			clearCascade(*point);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void clearCascade(std::nullptr_t)
+	{}
+
+#if defined(__cpp_exceptions)
+	namespace detail
+	{
+		// Rethrows exception installed to point, returns if there is
+		// none
+		FAULT_INJECTION_API
+		void rethrowException(const point_t & point);
+	}
+
+	// Install exception thrown by FAULT_INJECT_EXCEPTION instead of
+	// exception of injection site. The same exception object is
+	// rethrown on every trigger without lock, null pointer removes
+	// it. Replaced exceptions are kept until exit.
+	FAULT_INJECTION_API
+	void setException(point_t & point, std::exception_ptr exception);
+
+	__attribute__((visibility("hidden")))
+	inline void setException(const char * space, const char * name, std::exception_ptr exception)
+	{
+		if (point_t * point = find(space, name)) {
+			setException(*point, std::move(exception));
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void setException(std::nullptr_t, std::exception_ptr)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void resetException(point_t & point)
+	{
+		setException(point, nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetException(const char * space, const char * name)
+	{
+		setException(space, name, nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetException(std::nullptr_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasException(const point_t & point)
+	{
+		return (getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.exception) != nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasException(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			return hasException(*point);
+		}
+
+		return false;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasException(std::nullptr_t)
+	{
+		return false;
+	}
+#endif
+
+	namespace detail
+	{
+		// Sites of all modules, shared like registry itself
+		__attribute__((visibility("default")))
+		module_sites_t * getSiteModules();
+	}
+
+	template<typename Function>
+	__attribute__((visibility("hidden")))
+	inline void forEachSite(Function function)
+	{
+		for (detail::module_sites_t * module = detail::getSiteModules(); module != nullptr; module = module->next) {
+			for (site_t ** site = module->begin; site != module->end; ++site) {
+				// Placeholder which keeps section defined is null
+				if (*site != nullptr) {
+					function(**site);
+				}
+			}
+		}
+	}
+
+	// Visits sites of point, there can be many sites in different
+	// modules
+	template<typename Function>
+	__attribute__((visibility("hidden")))
+	inline void forEachSite(const point_t & point, Function function)
+	{
+		forEachSite([&point, &function](site_t & site) {
+			if (site.point == &point) {
+				function(site);
+			}
+		});
+	}
+
+	// Lookup site by line and file, `file` can be trailing part of
+	// path after '/' (e.g. "io.cpp" matches "src/io.cpp")
+	FAULT_INJECTION_API
+	site_t * findSite(const char * file, unsigned int line);
+
+	__attribute__((visibility("hidden")))
+	inline std::uint64_t getEvaluated(const site_t & site)
+	{
+		return FAULT_INJECTION_READ(&site.evaluated);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline std::uint64_t getTriggered(const site_t & site)
+	{
+		return FAULT_INJECTION_READ(&site.triggered);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetCounters(site_t & site)
+	{
+		FAULT_INJECTION_WRITE(&site.evaluated, std::uint64_t{0});
+		FAULT_INJECTION_WRITE(&site.triggered, std::uint64_t{0});
+	}
+
+	// Activate point only for this site and other selected sites,
+	// selection lasts until point is deactivated or activated for all
+	// sites by activate()
+	FAULT_INJECTION_API
+	void activateSite(site_t & site, mode_t mode = mode_t::multiple);
+
+	__attribute__((visibility("hidden")))
+	inline void activateSite(std::nullptr_t, mode_t = mode_t::multiple)
+	{}
+
+	// Point is deactivated with last selected site
+	FAULT_INJECTION_API
+	void deactivateSite(site_t & site);
+
+	__attribute__((visibility("hidden")))
+	inline void deactivateSite(std::nullptr_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline bool isSiteSelected(const site_t & site)
+	{
+		return FAULT_INJECTION_READ(&site.selected);
+	}
+
+	// Called by injection macros for active point when condition is
+	// satisfied, returns true if fault should be injected. The point
+	// should have current layout. It is kept out of injection sites
+	// so inactive path stays short.
+	__attribute__((visibility("hidden"),noinline,cold))
+	inline bool trigger(point_t & point, site_t * site = nullptr)
+	{
+		if (site != nullptr) {
+			FAULT_INJECTION_FETCH_ADD(&site->evaluated, std::uint64_t{1});
+		}
+
+		if ((FAULT_INJECTION_READ(&point.versions.v2.selected_sites) != 0) && ((site == nullptr) || !FAULT_INJECTION_READ(&site->selected))) {
+			return false;
+		}
+
+		// Deadline is checked only for enabled points
+		if ((FAULT_INJECTION_READ(&point.versions.v2.expiry) != 0) && detail::isExpired(point)) {
+			return false;
+		}
+
+		// Stack is walked only for enabled points
+		if ((FAULT_INJECTION_READ(&point.versions.v2.caller_filter) != nullptr) && !detail::matchCaller(point, __builtin_frame_address(0))) {
+			return false;
+		}
+
+		bool result;
+		switch (detail::getSession()) {
+		case detail::session_t::record:
+			result = detail::recordHit(point, detail::decide(point));
+			break;
+
+		case detail::session_t::replay:
+			result = detail::replayHit(point);
+			break;
+
+		case detail::session_t::fuzz:
+			result = detail::fuzzHit(point);
+			break;
+
+		default:
+			result = detail::decide(point);
+			break;
+		}
+
+		if (detail::statistics_slot_t * slot = FAULT_INJECTION_READ(&point.versions.v2.statistics)) {
+			detail::count(*slot, result);
+		}
+
+		if (result && (site != nullptr)) {
+			FAULT_INJECTION_FETCH_ADD(&site->triggered, std::uint64_t{1});
+		}
+
+		if (result && (FAULT_INJECTION_READ(&point.versions.v2.cascade) != nullptr)) {
+			detail::cascade(point);
+		}
+
+		return result;
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		constexpr bool is_payload_v = std::is_trivially_copyable_v<T> && (sizeof(T) <= sizeof(point_t::versions_t::v2_t::payload)) && (alignof(T) <= alignof(std::uint64_t));
+
+		// Type tag is derived from type name to be the same in all modules
+		template<typename T>
+		constexpr std::uint32_t payloadType()
+		{
+			std::uint32_t hash = 2166136261u;
+
+			for (const char * ptr = __PRETTY_FUNCTION__; *ptr != '\0'; ++ptr) {
+				hash = (hash ^ static_cast<unsigned char>(*ptr)) * 16777619u;
+			}
+
+			// 0 is reserved for missing value
+			return (hash != 0) ? hash : 1;
+		}
+
+		// Sequence lock for data wider than atomic word, writers
+		// make sequence odd while updating
+		__attribute__((visibility("hidden")))
+		inline std::uint32_t lockSequence(std::uint32_t * sequence)
+		{
+			std::uint32_t value = FAULT_INJECTION_READ(sequence) & ~1u;
+
+			while (!FAULT_INJECTION_CAS(sequence, &value, value + 1)) {
+				value &= ~1u;
+			}
+
+			return value + 1;
+		}
+
+		__attribute__((visibility("hidden")))
+		inline void unlockSequence(std::uint32_t * sequence, std::uint32_t locked)
+		{
+			FAULT_INJECTION_WRITE(sequence, locked + 1);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasValue(const point_t & point)
+	{
+		return (getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.payload_type) != 0);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasValue(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			return hasValue(*point);
+		}
+
+		return false;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasValue(std::nullptr_t)
+	{
+		return false;
+	}
+
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline void setValue(point_t & point, T value)
+	{
+		static_assert(detail::is_payload_v<T>, "Value should be trivially copyable and fit into point");
+
+		if (getPointVersion(point) < 2) {
+			return;
+		}
+
+		auto & data = point.versions.v2;
+		std::uint64_t words[2] = {};
+		std::memcpy(words, &value, sizeof(T));
+
+		const std::uint32_t sequence = detail::lockSequence(&data.payload_sequence);
+
+		static_cast<void>(FAULT_INJECTION_WRITE(&data.payload_type, detail::payloadType<T>()));
+		static_cast<void>(FAULT_INJECTION_WRITE(&data.payload[0], words[0]));
+		static_cast<void>(FAULT_INJECTION_WRITE(&data.payload[1], words[1]));
+		detail::unlockSequence(&data.payload_sequence, sequence);
+	}
+
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline void setValue(const char * space, const char * name, T value)
+	{
+		if (point_t * point = find(space, name)) {
+			setValue(*point, value);
+		}
+	}
+
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline void setValue(std::nullptr_t, T)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void resetValue(point_t & point)
+	{
+		if (getPointVersion(point) < 2) {
+			return;
+		}
+
+		auto & data = point.versions.v2;
+
+		const std::uint32_t sequence = detail::lockSequence(&data.payload_sequence);
+
+		FAULT_INJECTION_WRITE(&data.payload_type, std::uint32_t{0});
+		detail::unlockSequence(&data.payload_sequence, sequence);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetValue(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			resetValue(*point);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void resetValue(std::nullptr_t)
+	{}
+
+	// Return fallback when value is missing or has another type
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline T getValue(const point_t & point, T fallback = T{})
+	{
+		static_assert(detail::is_payload_v<T>, "Value should be trivially copyable and fit into point");
+
+		if (getPointVersion(point) < 2) {
+			return fallback;
+		}
+
+		const auto & data = point.versions.v2;
+		std::uint64_t words[2];
+		std::uint32_t type;
+		std::uint32_t sequence;
+
+		do {
+			sequence = FAULT_INJECTION_READ(&data.payload_sequence);
+			type = FAULT_INJECTION_READ(&data.payload_type);
+			words[0] = FAULT_INJECTION_READ(&data.payload[0]);
+			words[1] = FAULT_INJECTION_READ(&data.payload[1]);
+		} while (((sequence & 1u) != 0) || (sequence != FAULT_INJECTION_READ(&data.payload_sequence)));
+
+		if (type != detail::payloadType<T>()) {
+			return fallback;
+		}
+
+		std::memcpy(&fallback, words, sizeof(T));
+
+		return fallback;
+	}
+
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline T getValue(const char * space, const char * name, T fallback = T{})
+	{
+		if (point_t * point = find(space, name)) {
+			return getValue<T>(*point, fallback);
+		}
+
+		return fallback;
+	}
+
+	template<typename T>
+	__attribute__((visibility("hidden")))
+	inline T getValue(std::nullptr_t, T fallback = T{})
+	{
+		return fallback;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void installHook(point_t & point, hook_t hook, void * context = nullptr)
+	{
+		if (getPointVersion(point) < 2) {
+			return;
+		}
+
+		auto & data = point.versions.v2;
+		const std::uint32_t sequence = detail::lockSequence(&data.hook_sequence);
+
+		FAULT_INJECTION_WRITE(&data.hook_context, context);
+		FAULT_INJECTION_WRITE(&data.hook, hook);
+		detail::unlockSequence(&data.hook_sequence, sequence);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void installHook(const char * space, const char * name, hook_t hook, void * context = nullptr)
+	{
+		if (point_t * point = find(space, name)) {
+			installHook(*point, hook, context);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void installHook(std::nullptr_t, hook_t, void * = nullptr)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline void removeHook(point_t & point)
+	{
+		installHook(point, nullptr, nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void removeHook(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			removeHook(*point);
+		}
+	}
+
+	__attribute__((visibility("hidden")))
+	inline void removeHook(std::nullptr_t)
+	{}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasHook(const point_t & point)
+	{
+		return (getPointVersion(point) >= 2) && (FAULT_INJECTION_READ(&point.versions.v2.hook) != nullptr);
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasHook(const char * space, const char * name)
+	{
+		if (point_t * point = find(space, name)) {
+			return hasHook(*point);
+		}
+
+		return false;
+	}
+
+	__attribute__((visibility("hidden")))
+	inline bool hasHook(std::nullptr_t)
+	{
+		return false;
+	}
+
+	// Return true if hook has been called
+	__attribute__((visibility("hidden")))
+	inline bool callHook(point_t & point, void * argument = nullptr)
+	{
+		if (getPointVersion(point) < 2) {
+			return false;
+		}
+
+		const auto & data = point.versions.v2;
+		hook_t hook;
+		void * context;
+		std::uint32_t sequence;
+
+		do {
+			sequence = FAULT_INJECTION_READ(&data.hook_sequence);
+			hook = FAULT_INJECTION_READ(&data.hook);
+			context = FAULT_INJECTION_READ(&data.hook_context);
+		} while (((sequence & 1u) != 0) || (sequence != FAULT_INJECTION_READ(&data.hook_sequence)));
+
+		if (hook == nullptr) {
+			return false;
+		}
+
+		hook(point, context, argument);
+
+		return true;
+	}
+
+	class FAULT_INJECTION_API points_collection
+	{
+	public:
+		class iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type   = std::ptrdiff_t;
+			using value_type        = point_t;
+			using pointer           = point_t *;
+			using reference         = point_t &;
+
+			reference operator *() const noexcept
+			{
+				assert(ptr_ != nullptr);
+
+				return **ptr_;
+			}
+
+			pointer operator ->() const noexcept
+			{
+				assert(ptr_ != nullptr);
+
+				return *ptr_;
+			}
+
+			iterator& operator ++()
+			{
+				if (ptr_ == nullptr) {
+					return *this;
+				}
+
+				do {
+					++ptr_;
+					if (ptr_ == module_->end) {
+						do {
+							module_ = module_->next;
 						} while ((module_ != nullptr) && (module_->begin == module_->end));
 
 						ptr_ = (module_ != nullptr) ? module_->begin : nullptr;
@@ -583,5 +2194,128 @@ namespace avm::fault_injection
 		iterator end();
 	};
 
+	FAULT_INJECTION_API
 	extern points_collection points;
+
+	// Contiguous random access view of registered points. It is
+	// rebuilt when registry generation changes and keeps its storage
+	// alive so it is stable while modules are loaded.
+	class points_view
+	{
+	public:
+		using value_type     = point_t *;
+		using size_type      = std::size_t;
+		using iterator       = point_t * const *;
+		using const_iterator = point_t * const *;
+
+		points_view() = default;
+
+		points_view(std::shared_ptr<point_t * const []> points, size_type size, std::uint32_t generation):
+			points_(std::move(points)),
+			size_(size),
+			generation_(generation)
+		{}
+
+		const_iterator begin() const noexcept
+		{
+			return points_.get();
+		}
+
+		const_iterator end() const noexcept
+		{
+			return points_.get() + size_;
+		}
+
+		point_t * operator [](size_type index) const noexcept
+		{
+			return points_[index];
+		}
+
+		size_type size() const noexcept
+		{
+			return size_;
+		}
+
+		bool empty() const noexcept
+		{
+			return size_ == 0;
+		}
+
+		std::uint32_t generation() const noexcept
+		{
+			return generation_;
+		}
+
+	private:
+		std::shared_ptr<point_t * const []> points_;
+		size_type size_ = 0;
+		std::uint32_t generation_ = 0;
+	};
+
+	namespace detail
+	{
+		// Changed on every registration of module
+		FAULT_INJECTION_API
+		std::uint32_t getGeneration();
+
+		// Shared by all modules like registry itself
+		__attribute__((visibility("default")))
+		std::uint32_t * getGenerationCounter();
+	}
+
+	FAULT_INJECTION_API
+	points_view getPointsView();
+
+	// Point looked up by space and name once and cached until new
+	// module is registered, so points of other modules can be
+	// checked for the cost of compare and load. Strings should
+	// outlive handle.
+	class point_handle
+	{
+	public:
+		point_handle(const char * space, const char * name):
+			space_(space),
+			name_(name),
+			counter_(detail::getGenerationCounter()),
+			point_(nullptr),
+			generation_(FAULT_INJECTION_READ(counter_) - 1)
+		{}
+
+		point_handle(const point_handle & rhs):
+			point_handle(rhs.space_, rhs.name_)
+		{}
+
+		point_handle & operator =(const point_handle &) = delete;
+
+		point_t * get() const
+		{
+			const std::uint32_t generation = FAULT_INJECTION_READ(counter_);
+
+			if (generation != FAULT_INJECTION_READ(&generation_)) {
+				FAULT_INJECTION_WRITE(&point_, find(space_, name_));
+				FAULT_INJECTION_WRITE(&generation_, generation);
+			}
+
+			return FAULT_INJECTION_READ(&point_);
+		}
+
+		explicit operator bool() const
+		{
+			return get() != nullptr;
+		}
+
+		bool isActive() const
+		{
+			const point_t * point = get();
+
+			return (point != nullptr) && ::avm::fault_injection::isActive(*point);
+		}
+
+	private:
+		const char * space_;
+		const char * name_;
+		const std::uint32_t * counter_;
+		mutable point_t * point_;
+		mutable std::uint32_t generation_;
+	};
 }
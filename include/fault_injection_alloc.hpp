@@ -0,0 +1,44 @@
+// -*- compile-command: "cd .. && make test" -*-
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fault_injection.hpp>
+
+namespace avm::fault_injection::alloc
+{
+	enum class function_t: std::uint8_t {
+		malloc,
+		calloc,
+		realloc,
+		posix_memalign,
+		operator_new,
+	};
+
+	struct policy_t
+	{
+		// Trigger every n-th allocation evaluated while point is
+		// active, 0 means every allocation
+		std::uint64_t nth = 0;
+		// Trigger only allocations with size not less than this value
+		std::size_t min_size = 0;
+		// Probability of trigger in range [0, 1]
+		double probability = 1.0;
+	};
+
+	__attribute__((visibility("hidden")))
+	point_t & getPoint(function_t function);
+
+	__attribute__((visibility("hidden")))
+	void setPolicy(function_t function, const policy_t & policy);
+
+	__attribute__((visibility("hidden")))
+	policy_t getPolicy(function_t function);
+
+	__attribute__((visibility("hidden")))
+	inline void resetPolicy(function_t function)
+	{
+		setPolicy(function, policy_t{});
+	}
+}
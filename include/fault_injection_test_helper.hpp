@@ -1,7 +1,12 @@
 // -*- compile-command: "cd .. && make test" -*-
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include <fault_injection.hpp>
 
@@ -124,4 +129,317 @@ namespace avm::fault_injection
 		std::optional<mode_t> old_mode_;
 		std::optional<int> old_error_;
 	};
+
+	// Point activation specification for MultiInjectionStateGuard,
+	// point is specified by reference or by space and name
+	class InjectionSpec
+	{
+	public:
+		InjectionSpec(point_t & point):
+			InjectionSpec{&point, {nullptr, nullptr}, mode_t::multiple, 0, false, false}
+		{}
+
+		InjectionSpec(point_t & point, mode_t mode):
+			InjectionSpec{&point, {nullptr, nullptr}, mode, 0, true, false}
+		{}
+
+		InjectionSpec(point_t & point, int error):
+			InjectionSpec{&point, {nullptr, nullptr}, mode_t::multiple, error, false, true}
+		{}
+
+		InjectionSpec(point_t & point, mode_t mode, int error):
+			InjectionSpec{&point, {nullptr, nullptr}, mode, error, true, true}
+		{}
+
+		InjectionSpec(const char * space, const char * name):
+			InjectionSpec{nullptr, {space, name}, mode_t::multiple, 0, false, false}
+		{}
+
+		InjectionSpec(const char * space, const char * name, mode_t mode):
+			InjectionSpec{nullptr, {space, name}, mode, 0, true, false}
+		{}
+
+		InjectionSpec(const char * space, const char * name, int error):
+			InjectionSpec{nullptr, {space, name}, mode_t::multiple, error, false, true}
+		{}
+
+		InjectionSpec(const char * space, const char * name, mode_t mode, int error):
+			InjectionSpec{nullptr, {space, name}, mode, error, true, true}
+		{}
+
+		// Points are not defined when fault injection is turned off
+		InjectionSpec(std::nullptr_t):
+			InjectionSpec{nullptr, {nullptr, nullptr}, mode_t::multiple, 0, false, false}
+		{}
+
+		InjectionSpec(std::nullptr_t, mode_t):
+			InjectionSpec{nullptr}
+		{}
+
+		InjectionSpec(std::nullptr_t, int):
+			InjectionSpec{nullptr}
+		{}
+
+		InjectionSpec(std::nullptr_t, mode_t, int):
+			InjectionSpec{nullptr}
+		{}
+
+	private:
+		point_t * point_;
+		point_name_t name_;
+		mode_t mode_;
+		int error_;
+		bool set_mode_;
+		bool set_error_;
+
+		InjectionSpec(point_t * point, point_name_t name, mode_t mode, int error, bool set_mode, bool set_error):
+			point_{point},
+			name_{name},
+			mode_{mode},
+			error_{error},
+			set_mode_{set_mode},
+			set_error_{set_error}
+		{}
+
+		friend class MultiInjectionStateGuard;
+	};
+
+	// Scoped guard for many points. Points specified by name are
+	// resolved by single pass over registry. Previous state is kept in
+	// single buffer and restored in reverse order on destruction. The
+	// guards don't share state so they can be used by parallel threads
+	// for different points.
+	class MultiInjectionStateGuard
+	{
+	public:
+		MultiInjectionStateGuard(std::initializer_list<InjectionSpec> specs):
+			saved_{new saved_t[specs.size()]},
+			size_{0}
+		{
+			std::unique_ptr<point_name_t[]> names{new point_name_t[specs.size()]};
+			std::unique_ptr<point_t *[]> found{new point_t *[specs.size()]};
+			std::size_t count = 0;
+
+			for (const InjectionSpec & spec : specs) {
+				if ((spec.point_ == nullptr) && (spec.name_.space != nullptr)) {
+					names[count++] = spec.name_;
+				}
+			}
+
+			if (count != 0) {
+				findAll(names.get(), count, found.get());
+			}
+
+			std::size_t index = 0;
+			for (const InjectionSpec & spec : specs) {
+				point_t * point = spec.point_;
+				if ((point == nullptr) && (spec.name_.space != nullptr)) {
+					point = found[index++];
+				}
+
+				if (point != nullptr) {
+					apply(*point, spec);
+				}
+			}
+		}
+
+		MultiInjectionStateGuard(MultiInjectionStateGuard &&) = delete;
+		MultiInjectionStateGuard(const MultiInjectionStateGuard &) = delete;
+		MultiInjectionStateGuard & operator =(MultiInjectionStateGuard &&) = delete;
+		MultiInjectionStateGuard & operator =(const MultiInjectionStateGuard &) = delete;
+
+		~MultiInjectionStateGuard()
+		{
+			while (size_ != 0) {
+				const saved_t & saved = saved_[--size_];
+
+				if (saved.restore_error) {
+					setErrorCode(*saved.point, saved.error);
+				}
+				if (saved.restore_mode) {
+					setMode(*saved.point, saved.mode);
+				}
+				if (saved.reset_state) {
+					deactivate(*saved.point);
+				}
+			}
+		}
+
+		// Number of resolved points
+		std::size_t size() const
+		{
+			return size_;
+		}
+
+	private:
+		struct saved_t
+		{
+			point_t * point;
+			int error;
+			mode_t mode;
+			bool reset_state;
+			bool restore_mode;
+			bool restore_error;
+		};
+
+		std::unique_ptr<saved_t[]> saved_;
+		std::size_t size_;
+
+		void apply(point_t & point, const InjectionSpec & spec)
+		{
+			saved_[size_++] = saved_t{&point, getErrorCode(point), getMode(point), !isActive(point), spec.set_mode_, spec.set_error_};
+
+			if (spec.set_error_) {
+				setErrorCode(point, spec.error_);
+			}
+			activate(point, spec.set_mode_ ? spec.mode_ : getMode(point));
+		}
+	};
+
+	// Captures activation status, mode and error code of all
+	// registered points. While snapshot exists changes of points are
+	// recorded to journal, so restore() touches only changed
+	// points. Only one snapshot can record changes at a time, others
+	// compare all points on restore. Points registered after snapshot
+	// creation are not restored.
+	class RegistrySnapshot
+	{
+	public:
+		RegistrySnapshot()
+		{
+			for (point_t & point : points) {
+				entries_.push_back(entry_t{&point, getErrorCode(point), getMode(point), isActive(point)});
+			}
+
+			std::sort(entries_.begin(), entries_.end(), [](const entry_t & lhs, const entry_t & rhs) {
+				return std::less<const point_t *>{}(lhs.point, rhs.point);
+			});
+
+			for (std::size_t i = 0; i < entries_.size(); ++i) {
+				if (getPointVersion(*entries_[i].point) < 2) {
+					legacy_.push_back(i);
+				}
+			}
+
+			journal_.resize(entries_.size() - legacy_.size());
+			journaling_ = detail::startJournal(journal_.data(), static_cast<std::uint32_t>(journal_.size()));
+		}
+
+		RegistrySnapshot(RegistrySnapshot &&) = delete;
+		RegistrySnapshot(const RegistrySnapshot &) = delete;
+		RegistrySnapshot & operator =(RegistrySnapshot &&) = delete;
+		RegistrySnapshot & operator =(const RegistrySnapshot &) = delete;
+
+		~RegistrySnapshot()
+		{
+			restore();
+
+			if (journaling_) {
+				detail::stopJournal();
+			}
+		}
+
+		// Should not be called concurrently with changes of points
+		void restore()
+		{
+			if (!journaling_) {
+				for (const entry_t & entry : entries_) {
+					restore(entry);
+				}
+
+				return;
+			}
+
+			const std::uint32_t size = detail::stopJournal();
+
+			if (size > journal_.size()) {
+				// Points registered after snapshot overflow journal
+				for (const entry_t & entry : entries_) {
+					restore(entry);
+				}
+			} else {
+				for (std::uint32_t i = 0; i < size; ++i) {
+					auto entry = std::lower_bound(entries_.begin(), entries_.end(), journal_[i], [](const entry_t & lhs, const point_t * rhs) {
+						return std::less<const point_t *>{}(lhs.point, rhs);
+					});
+
+					if ((entry != entries_.end()) && (entry->point == journal_[i])) {
+						restore(*entry);
+					}
+				}
+
+				for (std::size_t index : legacy_) {
+					restore(entries_[index]);
+				}
+			}
+
+			detail::startJournal(journal_.data(), static_cast<std::uint32_t>(journal_.size()));
+		}
+
+		std::size_t size() const
+		{
+			return entries_.size();
+		}
+
+	private:
+		struct entry_t
+		{
+			point_t * point;
+			int error_code;
+			mode_t mode;
+			bool active;
+		};
+
+		std::vector<entry_t> entries_;
+		std::vector<std::size_t> legacy_;
+		std::vector<point_t *> journal_;
+		bool journaling_;
+
+		static void restore(const entry_t & entry)
+		{
+			point_t & point = *entry.point;
+
+			if (getErrorCode(point) != entry.error_code) {
+				setErrorCode(point, entry.error_code);
+			}
+			if (getMode(point) != entry.mode) {
+				setMode(point, entry.mode);
+			}
+			if (isActive(point) != entry.active) {
+				if (entry.active) {
+					activate(point, entry.mode);
+				} else {
+					deactivate(point);
+				}
+			}
+		}
+	};
+
+	// Scoped fuzzing of injection decisions for single fuzz
+	// iteration, e.g. in LLVMFuzzerTestOneInput()
+	class FuzzingGuard
+	{
+	public:
+		FuzzingGuard(const std::uint8_t * data, std::size_t size):
+			started_{startFuzzing(data, size)}
+		{}
+
+		FuzzingGuard(const FuzzingGuard &) = delete;
+		FuzzingGuard & operator =(const FuzzingGuard &) = delete;
+
+		~FuzzingGuard()
+		{
+			if (started_) {
+				stopFuzzing();
+			}
+		}
+
+		bool started() const
+		{
+			return started_;
+		}
+
+	private:
+		bool started_;
+	};
 }
@@ -1,9 +1,43 @@
 // -*- compile-command: "cd .. && make test" -*-
 #include <fault_injection.hpp>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Allocation failures of recorder are ignored, without exceptions they
+// terminate the process like any other allocation
+#if defined(__cpp_exceptions)
+#define FAULT_INJECTION_TRY try
+#define FAULT_INJECTION_CATCH_ALL catch (...)
+#else
+#define FAULT_INJECTION_TRY if (true)
+#define FAULT_INJECTION_CATCH_ALL else
+#endif
+
+// Runtime state is shared by copies of static runtime linked to many
+// modules via weak symbols with default visibility. Shared runtime is
+// the only copy so its state stays hidden.
+#if defined(FAULT_INJECTION_SHARED)
+#define FAULT_INJECTION_STATE __attribute__((visibility("hidden")))
+#else
+#define FAULT_INJECTION_STATE __attribute__((weak,visibility("default")))
+#endif
 
 #if defined(__APPLE__)
 __attribute__((visibility("hidden")))
@@ -17,6 +51,19 @@ static avm::fault_injection::detail::module_points_t fault_injections = {
 	.end = &last_injection,
 	.registered = false,
 };
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t * first_site __asm("section$start$__DATA$__fault_sites");
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t * last_site __asm("section$end$__DATA$__fault_sites");
+__attribute__((visibility("hidden")))
+static avm::fault_injection::detail::module_sites_t fault_injection_sites = {
+	.next = nullptr,
+	.begin = &first_site,
+	.end = &last_site,
+	.registered = false,
+};
+// Placeholder to ensure that section exists
+static avm::fault_injection::site_t * fake_site __attribute__((used,section("__DATA,__fault_sites"))) = nullptr;
 #elif defined(__linux__)
 __attribute__((visibility("hidden")))
 extern avm::fault_injection::point_t *__start___faults;
@@ -28,8 +75,19 @@ static avm::fault_injection::detail::module_points_t fault_injections = {
 	.end = &__stop___faults,
 	.registered = false,
 };
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t *__start___fault_sites;
+__attribute__((visibility("hidden")))
+extern avm::fault_injection::site_t *__stop___fault_sites;
+static avm::fault_injection::detail::module_sites_t fault_injection_sites = {
+	.next = nullptr,
+	.begin = &__start___fault_sites,
+	.end = &__stop___fault_sites,
+	.registered = false,
+};
 // Fake instance to ensure that variables with sections start and stop are defined
 static avm::fault_injection::point_t * fake __attribute__((used,section("__faults"))) = nullptr;
+static avm::fault_injection::site_t * fake_site __attribute__((used,section("__fault_sites"))) = nullptr;
 #else
 #error "Unsupported platform"
 #endif
@@ -38,19 +96,34 @@ avm::fault_injection::points_collection avm::fault_injection::points{};
 
 namespace avm::fault_injection
 {
-	__attribute__((weak))
+	FAULT_INJECTION_STATE
 	detail::module_points_t * getModule()
 	{
 		return &fault_injections;
 	}
 
-	__attribute__((weak))
+	namespace detail
+	{
+		void attachGroups(module_points_t * points);
+		void attachStatistics(module_points_t * points);
+	}
+
+	__attribute__((weak,visibility("default")))
+	std::uint32_t * detail::getGenerationCounter()
+	{
+		static std::uint32_t generation = 0;
+
+		return &generation;
+	}
+
+	__attribute__((weak,visibility("default")))
 	void registerModuleImpl(detail::module_points_t * points)
 	{
 		if (points->next != nullptr) {
 			return;
 		}
 		if (getModule() == points) {
+			detail::attachGroups(points);
 			return;
 		}
 
@@ -65,12 +138,198 @@ namespace avm::fault_injection
 		module->next = points;
 		points->next = nullptr;
 		points->registered = true;
+
+		detail::attachGroups(points);
+		detail::attachStatistics(points);
+
+		FAULT_INJECTION_FETCH_ADD(detail::getGenerationCounter(), 1u);
+	}
+
+	__attribute__((weak,visibility("default")))
+	detail::module_sites_t * detail::getSiteModules()
+	{
+		return &fault_injection_sites;
+	}
+
+	__attribute__((weak,visibility("default")))
+	void registerSitesImpl(detail::module_sites_t * sites)
+	{
+		detail::module_sites_t * module = detail::getSiteModules();
+
+		if (sites->registered || (module == sites)) {
+			return;
+		}
+
+		while (true) {
+			if (module->begin == sites->begin) {
+				return;
+			}
+			if (module->next == nullptr) {
+				break;
+			}
+			module = module->next;
+		}
+
+		module->next = sites;
+		sites->next = nullptr;
+		sites->registered = true;
 	}
 
-	__attribute__((weak))
+	FAULT_INJECTION_STATE
 	void unregisterModule(detail::module_points_t * /*points*/)
 	{
 	}
+
+	namespace detail
+	{
+		struct journal_t
+		{
+			// 0 when journal is stopped
+			std::uint32_t epoch;
+			std::uint32_t last_epoch;
+			std::uint32_t size;
+			std::uint32_t capacity;
+			point_t ** entries;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::journal_t * getJournal()
+	{
+		static detail::journal_t journal{};
+
+		return &journal;
+	}
+
+	FAULT_INJECTION_STATE
+	detail::group_t ** getGroups()
+	{
+		static detail::group_t * groups = nullptr;
+
+		return &groups;
+	}
+}
+
+namespace
+{
+	using avm::fault_injection::detail::group_t;
+
+	// Group names are compared by full path so a child is found
+	// by path prefix
+	group_t * findGroup(const char * path, bool create)
+	{
+		group_t * parent = nullptr;
+		group_t ** first = avm::fault_injection::getGroups();
+		std::size_t begin = 0;
+
+		while (true) {
+			const char * separator = strstr(path + begin, "::");
+			const std::size_t length = (separator != nullptr) ? static_cast<std::size_t>(separator - path) : strlen(path);
+
+			group_t * group = *first;
+			while ((group != nullptr) && ((group->length != length) || (memcmp(group->name, path, length) != 0))) {
+				group = group->sibling;
+			}
+
+			if (group == nullptr) {
+				if (!create) {
+					return nullptr;
+				}
+
+				// Registration can be performed while allocation
+				// failures are injected
+				const bool active = (parent != nullptr) && FAULT_INJECTION_READ(&parent->active);
+				group = new (std::nothrow) group_t{path, length, parent, nullptr, *first, nullptr, false, active};
+				if (group == nullptr) {
+					return nullptr;
+				}
+
+				FAULT_INJECTION_WRITE(first, group);
+			}
+
+			if (separator == nullptr) {
+				return group;
+			}
+
+			parent = group;
+			first = &group->child;
+			begin = length + 2;
+		}
+	}
+
+	void enablePoint(avm::fault_injection::point_t & point, bool group_active)
+	{
+		using namespace avm::fault_injection::detail;
+
+		if (group_active) {
+			FAULT_INJECTION_FETCH_OR(&point.versions.v2.enabled, enabled_group);
+		} else {
+			FAULT_INJECTION_FETCH_AND(&point.versions.v2.enabled, static_cast<std::uint8_t>(~enabled_group));
+		}
+	}
+
+	// Effective state is stored to every point so injection macros
+	// check single word
+	void updateGroup(group_t & group, bool parent_active)
+	{
+		const bool active = parent_active || FAULT_INJECTION_READ(&group.enabled);
+
+		FAULT_INJECTION_WRITE(&group.active, active);
+
+		for (avm::fault_injection::point_t * point = group.points; point != nullptr; point = point->versions.v2.group_next) {
+			enablePoint(*point, active);
+		}
+
+		for (group_t * child = group.child; child != nullptr; child = child->sibling) {
+			updateGroup(*child, active);
+		}
+	}
+
+	bool enableGroup(const char * path, bool enabled)
+	{
+		group_t * group = findGroup(path, false);
+		if (group == nullptr) {
+			return false;
+		}
+
+		FAULT_INJECTION_WRITE(&group->enabled, enabled);
+		updateGroup(*group, (group->parent != nullptr) && FAULT_INJECTION_READ(&group->parent->active));
+
+		return true;
+	}
+}
+
+void avm::fault_injection::detail::attachGroups(module_points_t * points)
+{
+	for (point_t ** item = points->begin; item != points->end; ++item) {
+		point_t * point = *item;
+
+		if ((point == nullptr) || (getPointVersion(*point) < 2) || (FAULT_INJECTION_READ(&point->versions.v2.group) != nullptr)) {
+			continue;
+		}
+
+		if (group_t * group = ::findGroup(point->space, true)) {
+			point->versions.v2.group_next = group->points;
+			group->points = point;
+			FAULT_INJECTION_WRITE(&point->versions.v2.group, group);
+			enablePoint(*point, FAULT_INJECTION_READ(&group->active));
+		}
+	}
+}
+
+avm::fault_injection::detail::group_t * avm::fault_injection::detail::findGroup(const char * group)
+{
+	return ::findGroup(group, false);
+}
+
+bool avm::fault_injection::activateGroup(const char * group)
+{
+	return enableGroup(group, true);
+}
+
+bool avm::fault_injection::deactivateGroup(const char * group)
+{
+	return enableGroup(group, false);
 }
 
 avm::fault_injection::point_t * avm::fault_injection::find(const char * space, const char * name)
@@ -86,33 +345,1675 @@ avm::fault_injection::point_t * avm::fault_injection::find(const char * space, c
 	return nullptr;
 }
 
-avm::fault_injection::points_collection::const_iterator avm::fault_injection::points_collection::begin() const
+namespace
 {
-	return const_iterator{getModule()};
+	// Coarse clock is enough for expiry and it is much cheaper than
+	// precise one
+	std::uint64_t coarseNow()
+	{
+#if defined(__APPLE__)
+		return clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW_APPROX);
+#elif defined(__linux__)
+		struct timespec now;
+
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+		return static_cast<std::uint64_t>(now.tv_sec) * 1000000000u + static_cast<std::uint64_t>(now.tv_nsec);
+#else
+#error "Unsupported platform"
+#endif
+	}
+
+	// Rate limit needs precise clock: coarse one ticks every few
+	// milliseconds which caps rate to one token per tick. It is read
+	// only for enabled points (via vDSO on Linux).
+	std::uint64_t preciseNow()
+	{
+#if defined(__APPLE__)
+		return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+#elif defined(__linux__)
+		struct timespec now;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		return static_cast<std::uint64_t>(now.tv_sec) * 1000000000u + static_cast<std::uint64_t>(now.tv_nsec);
+#else
+#error "Unsupported platform"
+#endif
+	}
+
+	constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
 }
 
-avm::fault_injection::points_collection::iterator avm::fault_injection::points_collection::begin()
+void avm::fault_injection::setRateLimit(point_t & point, double rate, std::uint32_t burst)
 {
-	return iterator{getModule()};
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	auto & data = point.versions.v2;
+	std::uint64_t interval = never;
+	if (std::isinf(rate)) {
+		interval = 0;
+	} else if (rate > 0.0) {
+		interval = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::llround(1e9 / rate)), 1u);
+	}
+	const std::uint64_t tolerance = ((interval != 0) && (interval != never)) ? interval * (std::max<std::uint32_t>(burst, 1u) - 1u) : 0u;
+
+	FAULT_INJECTION_WRITE(&data.rate_tat, std::uint64_t{0});
+	FAULT_INJECTION_WRITE(&data.rate_tolerance, tolerance);
+	FAULT_INJECTION_WRITE(&data.rate_interval, interval);
 }
 
-avm::fault_injection::points_collection::const_iterator avm::fault_injection::points_collection::end() const
+bool avm::fault_injection::detail::takeToken(point_t & point)
 {
-	return const_iterator{};
+	if (getPointVersion(point) < 2) {
+		return true;
+	}
+
+	auto & data = point.versions.v2;
+	const std::uint64_t interval = FAULT_INJECTION_READ(&data.rate_interval);
+	if (interval == 0) {
+		// Rate limit is not set
+		return true;
+	}
+	if (interval == never) {
+		return false;
+	}
+
+	const std::uint64_t tolerance = FAULT_INJECTION_READ(&data.rate_tolerance);
+	const std::uint64_t now = preciseNow();
+	std::uint64_t tat = FAULT_INJECTION_READ(&data.rate_tat);
+	std::uint64_t next;
+
+	// Rejection doesn't write so exhausted bucket is cheap for
+	// concurrent callers
+	do {
+		const std::uint64_t start = std::max(tat, now);
+		if (start - now > tolerance) {
+			return false;
+		}
+
+		next = start + interval;
+	} while (!FAULT_INJECTION_CAS(&data.rate_tat, &tat, next));
+
+	return true;
 }
 
-avm::fault_injection::points_collection::iterator avm::fault_injection::points_collection::end()
+namespace
 {
-	return iterator{};
+	// Trigger count of point which has injected all its faults
+	constexpr std::uint32_t window_exhausted = std::numeric_limits<std::uint32_t>::max();
 }
 
-void avm::fault_injection::registerModule()
+bool avm::fault_injection::detail::takeDelay(point_t & point)
 {
-	if (!fault_injections.registered) {
-		avm::fault_injection::registerModuleImpl(&fault_injections);
+	if (getPointVersion(point) < 2) {
+		return false;
+	}
+
+	auto & data = point.versions.v2;
+
+	std::uint32_t delay = FAULT_INJECTION_READ(&data.trigger_delay);
+	while (delay != 0) {
+		if (FAULT_INJECTION_CAS(&data.trigger_delay, &delay, delay - 1)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool avm::fault_injection::detail::takeCount(point_t & point)
+{
+	if (getPointVersion(point) < 2) {
+		return true;
+	}
+
+	auto & data = point.versions.v2;
+
+	std::uint32_t count = FAULT_INJECTION_READ(&data.trigger_count);
+	while (count != 0) {
+		if (count == window_exhausted) {
+			return false;
+		}
+
+		if (FAULT_INJECTION_CAS(&data.trigger_count, &count, (count == 1) ? window_exhausted : count - 1)) {
+			if (count == 1) {
+				deactivate(point);
+			}
+
+			return true;
+		}
+	}
+
+	return true;
+}
+
+void avm::fault_injection::setTriggerWindow(point_t & point, std::uint32_t delay, std::uint32_t count)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	count = std::min(count, window_exhausted - 1);
+
+	FAULT_INJECTION_WRITE(&point.versions.v2.window_delay, delay);
+	FAULT_INJECTION_WRITE(&point.versions.v2.window_count, count);
+	FAULT_INJECTION_WRITE(&point.versions.v2.trigger_delay, delay);
+	FAULT_INJECTION_WRITE(&point.versions.v2.trigger_count, count);
+}
+
+namespace
+{
+	constexpr std::uint64_t perturbation_scale = std::uint64_t{1} << 32;
+	// Spin duration at full intensity
+	constexpr std::uint32_t max_spin = 20000;
+
+	std::uint64_t perturbation_state = 0;
+	avm::fault_injection::perturbation_counts_t perturbation_counts = {};
+
+	std::uint32_t nextRandom()
+	{
+		std::uint64_t value = FAULT_INJECTION_FETCH_ADD(&perturbation_state, 0x9e3779b97f4a7c15ull);
+
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+
+		return static_cast<std::uint32_t>((value ^ (value >> 31)) >> 32);
+	}
+
+	inline void relax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield");
+#else
+		asm volatile("" ::: "memory");
+#endif
+	}
+
+	// Forces migration by binding thread to another allowed CPU and
+	// restores original affinity, so scheduler can keep thread there
+	bool migrate(std::uint32_t random)
+	{
+#if defined(__linux__)
+		cpu_set_t original;
+		if (sched_getaffinity(0, sizeof(original), &original) != 0) {
+			return false;
+		}
+
+		const int count = CPU_COUNT(&original);
+		if (count < 2) {
+			return false;
+		}
+
+		const int current = sched_getcpu();
+		int target = static_cast<int>(random % static_cast<std::uint32_t>(count));
+
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &original) && (target-- == 0)) {
+				target = (cpu == current) ? -1 : cpu;
+				break;
+			}
+		}
+
+		if (target < 0) {
+			return false;
+		}
+
+		cpu_set_t single;
+		CPU_ZERO(&single);
+		CPU_SET(target, &single);
+
+		const bool result = sched_setaffinity(0, sizeof(single), &single) == 0;
+		sched_setaffinity(0, sizeof(original), &original);
+
+		return result;
+#else
+		static_cast<void>(random);
+		return false;
+#endif
+	}
+}
+
+void avm::fault_injection::detail::perturb(point_t & point)
+{
+	const std::uint32_t skip = FAULT_INJECTION_READ(&point.versions.v2.perturbation_skip);
+	const std::uint32_t random = nextRandom();
+
+	if ((skip == std::numeric_limits<std::uint32_t>::max()) || (random < skip)) {
+		return;
+	}
+
+	const std::uint64_t intensity = perturbation_scale - skip;
+
+	switch (random % 3) {
+	case 0:
+		if (migrate(random / 3)) {
+			FAULT_INJECTION_FETCH_ADD(&perturbation_counts.migrations, std::uint64_t{1});
+			break;
+		}
+		// Yield when thread can't be migrated
+		[[fallthrough]];
+
+	case 1:
+		sched_yield();
+		FAULT_INJECTION_FETCH_ADD(&perturbation_counts.yields, std::uint64_t{1});
+		break;
+
+	default:
+		FAULT_INJECTION_FETCH_ADD(&perturbation_counts.spins, std::uint64_t{1});
+		for (std::uint32_t i = static_cast<std::uint32_t>((random / 3) % (max_spin * intensity / perturbation_scale + 1)); i > 0; --i) {
+			relax();
+		}
+		break;
+	}
+}
+
+void avm::fault_injection::setPerturbation(point_t & point, double intensity)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	std::uint32_t skip = 0;
+	if (intensity <= 0.0) {
+		skip = std::numeric_limits<std::uint32_t>::max();
+	} else if (intensity < 1.0) {
+		skip = static_cast<std::uint32_t>((1.0 - intensity) * static_cast<double>(perturbation_scale - 1));
+	}
+
+	FAULT_INJECTION_WRITE(&point.versions.v2.perturbation_skip, skip);
+}
+
+avm::fault_injection::perturbation_counts_t avm::fault_injection::getPerturbationCounts()
+{
+	perturbation_counts_t result;
+	result.yields = FAULT_INJECTION_READ(&perturbation_counts.yields);
+	result.spins = FAULT_INJECTION_READ(&perturbation_counts.spins);
+	result.migrations = FAULT_INJECTION_READ(&perturbation_counts.migrations);
+
+	return result;
+}
+
+std::size_t avm::fault_injection::detail::shortSize(point_t & point, std::size_t size)
+{
+	switch (static_cast<short_io_t>(FAULT_INJECTION_READ(reinterpret_cast<const std::underlying_type_t<short_io_t> *>(&point.versions.v2.short_io)))) {
+	case short_io_t::fixed: {
+		const std::uint64_t limit = FAULT_INJECTION_READ(&point.versions.v2.short_io_limit);
+
+		return static_cast<std::size_t>(std::clamp<std::uint64_t>(limit, 1, size - 1));
+	}
+
+	case short_io_t::random:
+		return 1 + static_cast<std::size_t>(nextRandom() % (size - 1));
+
+	default:
+		return 1;
+	}
+}
+
+void avm::fault_injection::setShortIo(point_t & point, short_io_t policy, std::size_t limit)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	FAULT_INJECTION_WRITE(&point.versions.v2.short_io_limit, static_cast<std::uint64_t>(limit));
+	FAULT_INJECTION_WRITE(reinterpret_cast<std::underlying_type_t<short_io_t> *>(&point.versions.v2.short_io), static_cast<std::underlying_type_t<short_io_t>>(policy));
+}
+
+bool avm::fault_injection::detail::isExpired(point_t & point)
+{
+	std::uint64_t deadline = FAULT_INJECTION_READ(&point.versions.v2.expiry);
+	if ((deadline == 0) || (coarseNow() < deadline)) {
+		return false;
+	}
+
+	// Only one thread deactivates point
+	if (FAULT_INJECTION_CAS(&point.versions.v2.expiry, &deadline, std::uint64_t{0})) {
+		deactivate(point);
+	}
+
+	return true;
+}
+
+void avm::fault_injection::setTtl(point_t & point, double ttl)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	std::uint64_t deadline = 0;
+	if (ttl <= 0.0) {
+		deadline = 1;
+	} else if (ttl < 1e9) {
+		// Longer time to live (infinity included) never expires
+		deadline = coarseNow() + static_cast<std::uint64_t>(ttl * 1e9);
 	}
+
+	FAULT_INJECTION_WRITE(&point.versions.v2.expiry, deadline);
 }
 
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		// Immutable except position once published to point
+		struct error_set_t
+		{
+			std::vector<int> codes;
+			// Cumulative weights scaled to 2^32, empty for sequence
+			std::vector<std::uint64_t> thresholds;
+			std::uint64_t position;
+		};
+
+		// Replaced sets can still be used by triggers in other
+		// threads so they are kept until exit
+		struct error_set_state_t
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<error_set_t>> sets;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::error_set_state_t * getErrorSetState()
+	{
+		static detail::error_set_state_t state{};
+
+		return &state;
+	}
+}
+
+namespace
+{
+	void publishErrorSet(avm::fault_injection::point_t & point, std::unique_ptr<avm::fault_injection::detail::error_set_t> set)
+	{
+		using avm::fault_injection::detail::error_set_t;
+
+		avm::fault_injection::detail::error_set_state_t & state = *avm::fault_injection::getErrorSetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		error_set_t * published = set.get();
+		if (published != nullptr) {
+			state.sets.push_back(std::move(set));
+		}
+
+		FAULT_INJECTION_WRITE(&point.versions.v2.error_set, published);
+	}
+}
+
+namespace
+{
+	// Error code chosen by fuzzer for the last hit of the calling thread
+	bool takeFuzzErrorCode(const avm::fault_injection::point_t & point, int & code);
+}
+
+int avm::fault_injection::detail::nextErrorCode(point_t & point)
+{
+	int fuzz_code;
+	if (takeFuzzErrorCode(point, fuzz_code)) {
+		return fuzz_code;
+	}
+
+	error_set_t * set = FAULT_INJECTION_READ(&point.versions.v2.error_set);
+	if (set == nullptr) {
+		return current::getErrorCode(point);
+	}
+
+	if (set->thresholds.empty()) {
+		const std::uint64_t position = FAULT_INJECTION_FETCH_ADD(&set->position, 1) - 1;
+
+		return set->codes[position % set->codes.size()];
+	}
+
+	const std::uint64_t random = nextRandom();
+	const auto threshold = std::upper_bound(set->thresholds.begin(), set->thresholds.end(), random);
+
+	return set->codes[std::min<std::size_t>(threshold - set->thresholds.begin(), set->codes.size() - 1)];
+}
+
+void avm::fault_injection::setErrorSequence(point_t & point, const int * codes, std::size_t count)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	if (count == 0) {
+		publishErrorSet(point, nullptr);
+		return;
+	}
+
+	std::unique_ptr<detail::error_set_t> set{new detail::error_set_t{}};
+	set->codes.assign(codes, codes + count);
+
+	publishErrorSet(point, std::move(set));
+}
+
+void avm::fault_injection::setErrorWeights(point_t & point, const int * codes, const double * weights, std::size_t count)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	double total = 0.0;
+	for (std::size_t i = 0; i < count; ++i) {
+		total += std::max(weights[i], 0.0);
+	}
+
+	if (!(total > 0.0)) {
+		publishErrorSet(point, nullptr);
+		return;
+	}
+
+	constexpr double scale = static_cast<double>(std::uint64_t{1} << 32);
+
+	std::unique_ptr<detail::error_set_t> set{new detail::error_set_t{}};
+	double sum = 0.0;
+
+	for (std::size_t i = 0; i < count; ++i) {
+		// Codes without weight are never sampled
+		if (!(weights[i] > 0.0)) {
+			continue;
+		}
+
+		sum += weights[i];
+		set->codes.push_back(codes[i]);
+		set->thresholds.push_back(static_cast<std::uint64_t>(sum / total * scale));
+	}
+	set->thresholds.back() = std::uint64_t{1} << 32;
+
+	publishErrorSet(point, std::move(set));
+}
+
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		// Adjacency list of point, immutable once published
+		struct cascade_table_t
+		{
+			std::vector<std::pair<point_t *, cascade_t>> edges;
+		};
+
+		// Replaced tables can still be walked by triggers in other
+		// threads so they are kept until exit
+		struct cascade_state_t
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<cascade_table_t>> tables;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::cascade_state_t * getCascadeState()
+	{
+		static detail::cascade_state_t state{};
+
+		return &state;
+	}
+}
+
+void avm::fault_injection::detail::cascade(point_t & point)
+{
+	const cascade_table_t * table = FAULT_INJECTION_READ(&point.versions.v2.cascade);
+	if (table == nullptr) {
+		return;
+	}
+
+	for (const auto & item : table->edges) {
+		point_t & target = *item.first;
+		const cascade_t & edge = item.second;
+
+		switch (edge.action) {
+		case cascade_action_t::activate:
+			setTriggerWindow(target, edge.delay, edge.count);
+			activate(target, edge.mode);
+			break;
+
+		case cascade_action_t::deactivate:
+			deactivate(target);
+			break;
+
+		case cascade_action_t::set_error_code:
+			setErrorCode(target, edge.error_code);
+			break;
+		}
+	}
+}
+
+bool avm::fault_injection::addCascade(point_t & source, point_t & target, const cascade_t & edge)
+{
+	if ((getPointVersion(source) < 2) || (getPointVersion(target) < 2)) {
+		return false;
+	}
+
+	detail::cascade_state_t & state = *getCascadeState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	std::unique_ptr<detail::cascade_table_t> table{new detail::cascade_table_t{}};
+	if (const detail::cascade_table_t * previous = source.versions.v2.cascade) {
+		table->edges = previous->edges;
+	}
+	table->edges.emplace_back(&target, edge);
+
+	state.tables.push_back(std::move(table));
+	FAULT_INJECTION_WRITE(&source.versions.v2.cascade, state.tables.back().get());
+
+	return true;
+}
+
+void avm::fault_injection::clearCascade(point_t & source)
+{
+	if (getPointVersion(source) < 2) {
+		return;
+	}
+
+	detail::cascade_state_t & state = *getCascadeState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	FAULT_INJECTION_WRITE(&source.versions.v2.cascade, static_cast<detail::cascade_table_t *>(nullptr));
+}
+
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		// Open addressing set of hashes, immutable once published
+		struct caller_filter_t
+		{
+			unsigned int depth;
+			std::uint64_t mask;
+			std::vector<std::uint64_t> slots;
+		};
+
+		// Replaced filters can still be used by triggers in other
+		// threads so they are kept until exit
+		struct caller_filter_state_t
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<caller_filter_t>> filters;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::caller_filter_state_t * getCallerFilterState()
+	{
+		static detail::caller_filter_state_t state{};
+
+		return &state;
+	}
+}
+
+namespace
+{
+	// Frames of callers are farther than this from each other only
+	// when frame pointer is used as general register
+	constexpr std::uintptr_t max_frame_size = std::uintptr_t{1} << 20;
+
+	// Stack of current thread, frames outside of it are never read
+	struct stack_bounds_t
+	{
+		std::uintptr_t begin;
+		std::uintptr_t end;
+	};
+
+	thread_local stack_bounds_t thread_stack = {0, 0};
+	thread_local bool thread_stack_checked = false;
+
+	// Bounds are looked up once per thread. Lookup can allocate memory
+	// (glibc reads /proc/self/maps for main thread), so walk triggered
+	// by nested allocation hook sees empty bounds, as does thread with
+	// unknown stack.
+	const stack_bounds_t & threadStack()
+	{
+		if (thread_stack_checked) {
+			return thread_stack;
+		}
+
+		thread_stack_checked = true;
+
+#if defined(__APPLE__)
+		const auto end = reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(pthread_self()));
+
+		thread_stack = {end - pthread_get_stacksize_np(pthread_self()), end};
+#elif defined(__linux__)
+		pthread_attr_t attributes;
+
+		if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+			void * address = nullptr;
+			size_t size = 0;
+
+			if (pthread_attr_getstack(&attributes, &address, &size) == 0) {
+				thread_stack = {reinterpret_cast<std::uintptr_t>(address), reinterpret_cast<std::uintptr_t>(address) + size};
+			}
+
+			pthread_attr_destroy(&attributes);
+		}
+#endif
+
+		return thread_stack;
+	}
+
+	// Frame record is saved frame pointer followed by return address
+	// on supported architectures
+	bool insideStack(const void * const * frame, const stack_bounds_t & stack)
+	{
+		const auto address = reinterpret_cast<std::uintptr_t>(frame);
+
+		return (address >= stack.begin) && (address < stack.end) && ((stack.end - address) >= 2 * sizeof(void *));
+	}
+
+	// Moves to frame of caller. Fails for frame which doesn't look like
+	// caller frame, e.g. when code is built without frame pointers and
+	// saved frame pointer slot holds arbitrary data.
+	bool callerFrame(const void * const *& frame, const stack_bounds_t & stack)
+	{
+		auto next = static_cast<const void * const *>(frame[0]);
+		const std::uintptr_t distance = reinterpret_cast<std::uintptr_t>(next) - reinterpret_cast<std::uintptr_t>(frame);
+
+		if ((next <= frame) || (distance > max_frame_size) || ((reinterpret_cast<std::uintptr_t>(next) % alignof(void *)) != 0) || !insideStack(next, stack)) {
+			return false;
+		}
+
+		frame = next;
+
+		return true;
+	}
+
+	// Hash of return addresses starting with return address of
+	// function called by function with `frame`. Walk starting outside
+	// of thread stack (e.g. on signal or coroutine stack) gives 0.
+	std::uint64_t hashCallers(const void * frame, unsigned int depth)
+	{
+		std::uint64_t hash = 0;
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+		const stack_bounds_t & stack = threadStack();
+		auto current = static_cast<const void * const *>(frame);
+
+		if (!insideStack(current, stack)) {
+			return 0;
+		}
+
+		for (unsigned int i = 0; (i < depth) && callerFrame(current, stack); ++i) {
+			const std::uint64_t address = reinterpret_cast<std::uintptr_t>(current[1]);
+
+			hash = (i == 0) ? address : ((hash * 0x100000001b3ull) ^ address);
+		}
+#else
+		static_cast<void>(frame);
+		static_cast<void>(depth);
+#endif
+
+		return hash;
+	}
+
+	std::uint64_t slotIndex(std::uint64_t hash, std::uint64_t mask)
+	{
+		return ((hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ull >> 32) & mask;
+	}
+}
+
+bool avm::fault_injection::detail::matchCaller(const point_t & point, const void * frame)
+{
+	const caller_filter_t * filter = FAULT_INJECTION_READ(&point.versions.v2.caller_filter);
+	if (filter == nullptr) {
+		return true;
+	}
+
+	const std::uint64_t hash = hashCallers(frame, filter->depth);
+	if (hash == 0) {
+		return false;
+	}
+
+	for (std::uint64_t i = slotIndex(hash, filter->mask); filter->slots[i] != 0; i = (i + 1) & filter->mask) {
+		if (filter->slots[i] == hash) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::uint64_t avm::fault_injection::getCallerHash(unsigned int depth)
+{
+	// Frame of this function is skipped like frame of trigger()
+	return hashCallers(__builtin_frame_address(0), depth);
+}
+
+void avm::fault_injection::setCallerFilter(point_t & point, unsigned int depth, const std::uint64_t * hashes, std::size_t count)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	detail::caller_filter_state_t & state = *getCallerFilterState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (count == 0) {
+		FAULT_INJECTION_WRITE(&point.versions.v2.caller_filter, static_cast<detail::caller_filter_t *>(nullptr));
+		return;
+	}
+
+	// Load factor is kept at most 1/2 so probe sequence is short
+	std::size_t capacity = 4;
+	while (capacity < count * 2) {
+		capacity *= 2;
+	}
+
+	std::unique_ptr<detail::caller_filter_t> filter{new detail::caller_filter_t{std::max(depth, 1u), capacity - 1, std::vector<std::uint64_t>(capacity, 0)}};
+
+	for (std::size_t i = 0; i < count; ++i) {
+		// Zero marks empty slot, it is never matched
+		if (hashes[i] == 0) {
+			continue;
+		}
+
+		std::uint64_t index = slotIndex(hashes[i], filter->mask);
+		while ((filter->slots[index] != 0) && (filter->slots[index] != hashes[i])) {
+			index = (index + 1) & filter->mask;
+		}
+		filter->slots[index] = hashes[i];
+	}
+
+	state.filters.push_back(std::move(filter));
+	FAULT_INJECTION_WRITE(&point.versions.v2.caller_filter, state.filters.back().get());
+}
+
+bool avm::fault_injection::detail::startJournal(point_t ** entries, std::uint32_t capacity)
+{
+	journal_t * journal = getJournal();
+
+	if (FAULT_INJECTION_READ(&journal->epoch) != 0) {
+		return false;
+	}
+
+	std::uint32_t epoch = journal->last_epoch + 1;
+	if (epoch == 0) {
+		epoch = 1;
+	}
+
+	journal->last_epoch = epoch;
+	journal->entries = entries;
+	journal->capacity = capacity;
+	FAULT_INJECTION_WRITE(&journal->size, std::uint32_t{0});
+	FAULT_INJECTION_WRITE(&journal->epoch, epoch);
+
+	return true;
+}
+
+std::uint32_t avm::fault_injection::detail::stopJournal()
+{
+	journal_t * journal = getJournal();
+
+	FAULT_INJECTION_WRITE(&journal->epoch, std::uint32_t{0});
+
+	return FAULT_INJECTION_READ(&journal->size);
+}
+
+void avm::fault_injection::detail::journal(point_t & point)
+{
+	journal_t * journal = getJournal();
+	const std::uint32_t epoch = FAULT_INJECTION_READ(&journal->epoch);
+
+	// Old points are not recorded, snapshot checks them always
+	if ((epoch == 0) || (getPointVersion(point) < 2)) {
+		return;
+	}
+
+	// Record every point once per epoch
+	std::uint32_t recorded = FAULT_INJECTION_READ(&point.versions.v2.journal_epoch);
+	do {
+		if (recorded == epoch) {
+			return;
+		}
+	} while (!FAULT_INJECTION_CAS(&point.versions.v2.journal_epoch, &recorded, epoch));
+
+	const std::uint32_t index = FAULT_INJECTION_FETCH_ADD(&journal->size, 1u) - 1u;
+	if (index < journal->capacity) {
+		journal->entries[index] = &point;
+	}
+}
+
+void avm::fault_injection::findAll(const point_name_t * names, std::size_t count, point_t ** result)
+{
+	std::fill(result, result + count, nullptr);
+
+	std::size_t left = count;
+
+	for (auto point = points.begin(); (left != 0) && (point != points.end()); ++point) {
+		const char * space = getSpace(*point);
+		const char * name = getName(*point);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			if ((result[i] == nullptr) && (strcmp(space, names[i].space) == 0) && (strcmp(name, names[i].name) == 0)) {
+				result[i] = &*point;
+				--left;
+			}
+		}
+	}
+}
+
+avm::fault_injection::points_collection::const_iterator avm::fault_injection::points_collection::begin() const
+{
+	return const_iterator{getModule()};
+}
+
+avm::fault_injection::points_collection::iterator avm::fault_injection::points_collection::begin()
+{
+	return iterator{getModule()};
+}
+
+avm::fault_injection::points_collection::const_iterator avm::fault_injection::points_collection::end() const
+{
+	return const_iterator{};
+}
+
+avm::fault_injection::points_collection::iterator avm::fault_injection::points_collection::end()
+{
+	return iterator{};
+}
+
+std::uint32_t avm::fault_injection::detail::getGeneration()
+{
+	return FAULT_INJECTION_READ(getGenerationCounter());
+}
+
+avm::fault_injection::points_view avm::fault_injection::getPointsView()
+{
+	static std::shared_ptr<const points_view> cache;
+
+	const std::uint32_t generation = detail::getGeneration();
+
+	std::shared_ptr<const points_view> view = std::atomic_load(&cache);
+	if ((view != nullptr) && (view->generation() == generation)) {
+		return *view;
+	}
+
+	const std::size_t size = static_cast<std::size_t>(std::distance(points.begin(), points.end()));
+	std::shared_ptr<point_t * []> items(new point_t * [size]);
+
+	std::transform(points.begin(), points.end(), items.get(), [](point_t & point) {
+		return &point;
+	});
+
+	view = std::make_shared<const points_view>(std::move(items), size, generation);
+	std::atomic_store(&cache, view);
+
+	return *view;
+}
+
+namespace
+{
+	struct replay_point_t
+	{
+		// Sorted hits to inject and position of next one
+		std::vector<std::uint64_t> hits;
+		std::size_t next;
+	};
+
+	// Owned by session and used only by its thread so hot path
+	// doesn't take any locks
+	struct thread_buffer_t
+	{
+		std::uint32_t thread;
+		std::unordered_map<avm::fault_injection::point_t *, std::uint64_t> counters;
+		std::vector<std::pair<avm::fault_injection::point_t *, std::uint64_t>> hits;
+		std::unordered_map<avm::fault_injection::point_t *, replay_point_t> replay;
+	};
+
+	constexpr char replay_magic[4] = {'F', 'I', 'R', 'R'};
+	constexpr std::uint32_t replay_version = 1;
+}
+
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		struct fuzz_codes_t
+		{
+			std::unordered_map<const point_t *, std::vector<int>> codes;
+		};
+
+		struct session_state_t
+		{
+			session_t session;
+			// Changed on every start to invalidate thread buffers
+			std::uint32_t id;
+			std::mutex mutex;
+			std::vector<std::unique_ptr<thread_buffer_t>> threads;
+			// Hits loaded for replay by thread index
+			std::vector<std::unordered_map<point_t *, std::vector<std::uint64_t>>> replay;
+			// Fuzzer input consumed bit by bit
+			const std::uint8_t * fuzz_data;
+			std::size_t fuzz_bits;
+			std::size_t fuzz_position;
+			// Alternative error codes of points, published tables
+			// are immutable and kept until exit
+			const fuzz_codes_t * fuzz_codes;
+			std::vector<std::unique_ptr<const fuzz_codes_t>> fuzz_tables;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::session_state_t * getSessionState()
+	{
+		static detail::session_state_t state{};
+
+		return &state;
+	}
+}
+
+namespace
+{
+	using avm::fault_injection::detail::session_state_t;
+
+	thread_local std::uint32_t thread_session = 0;
+	thread_local thread_buffer_t * thread_buffer = nullptr;
+	// Error code chosen by fuzzer is passed to injection site of the
+	// same thread instead of changing point
+	thread_local const avm::fault_injection::point_t * thread_fuzz_point = nullptr;
+	thread_local std::uint32_t thread_fuzz_session = 0;
+	thread_local int thread_fuzz_code = 0;
+	// Guards against recursion via points hit by recorder itself
+	// (e.g. allocation failures)
+	thread_local bool thread_busy = false;
+
+	// Threads get indexes in order of their first hit
+	thread_buffer_t & threadBuffer(session_state_t & state)
+	{
+		const std::uint32_t id = FAULT_INJECTION_READ(&state.id);
+
+		if ((thread_buffer == nullptr) || (thread_session != id)) {
+			std::lock_guard<std::mutex> lock(state.mutex);
+
+			auto buffer = std::make_unique<thread_buffer_t>();
+			buffer->thread = static_cast<std::uint32_t>(state.threads.size());
+			if (buffer->thread < state.replay.size()) {
+				for (auto & item : state.replay[buffer->thread]) {
+					buffer->replay.emplace(item.first, replay_point_t{std::move(item.second), 0});
+				}
+			}
+
+			thread_buffer = buffer.get();
+			thread_session = id;
+			state.threads.push_back(std::move(buffer));
+		}
+
+		return *thread_buffer;
+	}
+
+	bool startSession(session_state_t & state, avm::fault_injection::detail::session_t session)
+	{
+		using avm::fault_injection::detail::session_t;
+
+		if (FAULT_INJECTION_READ(&state.session) != session_t::none) {
+			return false;
+		}
+
+		state.threads.clear();
+		FAULT_INJECTION_FETCH_ADD(&state.id, 1u);
+		FAULT_INJECTION_WRITE(&state.session, session);
+
+		return true;
+	}
+
+	bool writeAll(FILE * file, const void * data, std::size_t size)
+	{
+		return fwrite(data, 1, size, file) == size;
+	}
+
+	bool readAll(FILE * file, void * data, std::size_t size)
+	{
+		return fread(data, 1, size, file) == size;
+	}
+
+	bool readString(FILE * file, std::string & result)
+	{
+		result.clear();
+
+		int value;
+		while ((value = fgetc(file)) > 0) {
+			result.push_back(static_cast<char>(value));
+		}
+
+		return value == 0;
+	}
+}
+
+avm::fault_injection::detail::session_t avm::fault_injection::detail::getSession()
+{
+	return FAULT_INJECTION_READ(&getSessionState()->session);
+}
+
+bool avm::fault_injection::detail::recordHit(point_t & point, bool triggered)
+{
+	if (thread_busy) {
+		return triggered;
+	}
+
+	thread_busy = true;
+
+	FAULT_INJECTION_TRY {
+		thread_buffer_t & buffer = threadBuffer(*getSessionState());
+		const std::uint64_t hit = buffer.counters[&point]++;
+
+		if (triggered) {
+			buffer.hits.emplace_back(&point, hit);
+		}
+	} FAULT_INJECTION_CATCH_ALL {
+		// Hit is lost when recorder can't allocate memory
+	}
+
+	thread_busy = false;
+
+	return triggered;
+}
+
+bool avm::fault_injection::detail::replayHit(point_t & point)
+{
+	if (thread_busy) {
+		return false;
+	}
+
+	thread_busy = true;
+
+	bool result = false;
+	FAULT_INJECTION_TRY {
+		thread_buffer_t & buffer = threadBuffer(*getSessionState());
+		const std::uint64_t hit = buffer.counters[&point]++;
+
+		auto item = buffer.replay.find(&point);
+		if (item != buffer.replay.end()) {
+			replay_point_t & replay = item->second;
+
+			while ((replay.next < replay.hits.size()) && (replay.hits[replay.next] < hit)) {
+				++replay.next;
+			}
+			result = (replay.next < replay.hits.size()) && (replay.hits[replay.next] == hit);
+		}
+	} FAULT_INJECTION_CATCH_ALL {
+	}
+
+	thread_busy = false;
+
+	return result;
+}
+
+bool avm::fault_injection::startRecording()
+{
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	state.replay.clear();
+
+	return startSession(state, detail::session_t::record);
+}
+
+// File format in native byte order: magic, version, number of points
+// followed by null terminated space and name of every point, number
+// of threads followed by number of hits and hits of every thread. Hit
+// is point index and hit index.
+bool avm::fault_injection::stopRecording(const char * path)
+{
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (FAULT_INJECTION_READ(&state.session) != detail::session_t::record) {
+		return false;
+	}
+
+	FAULT_INJECTION_WRITE(&state.session, detail::session_t::none);
+
+	std::vector<point_t *> recorded;
+	std::unordered_map<point_t *, std::uint32_t> indexes;
+	for (const auto & buffer : state.threads) {
+		for (const auto & hit : buffer->hits) {
+			if (indexes.emplace(hit.first, static_cast<std::uint32_t>(recorded.size())).second) {
+				recorded.push_back(hit.first);
+			}
+		}
+	}
+
+	FILE * file = fopen(path, "wb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	bool result = writeAll(file, replay_magic, sizeof(replay_magic)) && writeAll(file, &replay_version, sizeof(replay_version));
+
+	const std::uint32_t count = static_cast<std::uint32_t>(recorded.size());
+	result = result && writeAll(file, &count, sizeof(count));
+	for (point_t * point : recorded) {
+		result = result && writeAll(file, getSpace(*point), strlen(getSpace(*point)) + 1) && writeAll(file, getName(*point), strlen(getName(*point)) + 1);
+	}
+
+	const std::uint32_t threads = static_cast<std::uint32_t>(state.threads.size());
+	result = result && writeAll(file, &threads, sizeof(threads));
+	for (const auto & buffer : state.threads) {
+		const std::uint32_t hits = static_cast<std::uint32_t>(buffer->hits.size());
+		result = result && writeAll(file, &hits, sizeof(hits));
+
+		for (const auto & hit : buffer->hits) {
+			const std::uint32_t index = indexes[hit.first];
+			result = result && writeAll(file, &index, sizeof(index)) && writeAll(file, &hit.second, sizeof(hit.second));
+		}
+	}
+
+	state.threads.clear();
+
+	return (fclose(file) == 0) && result;
+}
+
+bool avm::fault_injection::startReplay(const char * path)
+{
+	FILE * file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	char magic[sizeof(replay_magic)];
+	std::uint32_t version = 0;
+	std::uint32_t count = 0;
+
+	bool result = readAll(file, magic, sizeof(magic)) && (memcmp(magic, replay_magic, sizeof(magic)) == 0)
+		&& readAll(file, &version, sizeof(version)) && (version == replay_version)
+		&& readAll(file, &count, sizeof(count));
+
+	// Points missing in this process are resolved to nullptr and
+	// their hits are skipped
+	std::vector<point_t *> recorded;
+	std::string space;
+	std::string name;
+	for (std::uint32_t i = 0; result && (i < count); ++i) {
+		result = readString(file, space) && readString(file, name);
+		recorded.push_back(find(space.c_str(), name.c_str()));
+	}
+
+	std::uint32_t threads = 0;
+	result = result && readAll(file, &threads, sizeof(threads));
+
+	decltype(session_state_t::replay) replay(result ? threads : 0);
+	for (auto & thread : replay) {
+		std::uint32_t hits = 0;
+		result = result && readAll(file, &hits, sizeof(hits));
+
+		for (std::uint32_t i = 0; result && (i < hits); ++i) {
+			std::uint32_t index = 0;
+			std::uint64_t hit = 0;
+
+			result = readAll(file, &index, sizeof(index)) && readAll(file, &hit, sizeof(hit)) && (index < recorded.size());
+			if (result && (recorded[index] != nullptr)) {
+				thread[recorded[index]].push_back(hit);
+			}
+		}
+	}
+
+	fclose(file);
+
+	if (!result) {
+		return false;
+	}
+
+	for (auto & thread : replay) {
+		for (auto & item : thread) {
+			std::sort(item.second.begin(), item.second.end());
+		}
+	}
+
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (FAULT_INJECTION_READ(&state.session) != detail::session_t::none) {
+		return false;
+	}
+
+	state.replay = std::move(replay);
+
+	return startSession(state, detail::session_t::replay);
+}
+
+void avm::fault_injection::stopReplay()
+{
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (FAULT_INJECTION_READ(&state.session) == detail::session_t::replay) {
+		FAULT_INJECTION_WRITE(&state.session, detail::session_t::none);
+		state.threads.clear();
+		state.replay.clear();
+	}
+}
+
+namespace
+{
+	// Returns false when input is exhausted
+	bool takeBits(session_state_t & state, unsigned int count, std::uint32_t & result)
+	{
+		const std::size_t position = FAULT_INJECTION_FETCH_ADD(&state.fuzz_position, count) - count;
+		if (position + count > state.fuzz_bits) {
+			return false;
+		}
+
+		result = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			const std::size_t bit = position + i;
+
+			result |= static_cast<std::uint32_t>((state.fuzz_data[bit / 8] >> (bit % 8)) & 1u) << i;
+		}
+
+		return true;
+	}
+
+	bool takeFuzzErrorCode(const avm::fault_injection::point_t & point, int & code)
+	{
+		if (thread_fuzz_point != &point) {
+			return false;
+		}
+
+		thread_fuzz_point = nullptr;
+
+		const session_state_t & state = *avm::fault_injection::getSessionState();
+		if ((FAULT_INJECTION_READ(&state.session) != avm::fault_injection::detail::session_t::fuzz)
+		    || (FAULT_INJECTION_READ(&state.id) != thread_fuzz_session)) {
+			return false;
+		}
+
+		code = thread_fuzz_code;
+
+		return true;
+	}
+}
+
+bool avm::fault_injection::detail::fuzzHit(point_t & point)
+{
+	session_state_t & state = *getSessionState();
+
+	thread_fuzz_point = nullptr;
+
+	std::uint32_t triggered = 0;
+	if (!takeBits(state, 1, triggered) || (triggered == 0)) {
+		return false;
+	}
+
+	const fuzz_codes_t * table = FAULT_INJECTION_READ(&state.fuzz_codes);
+	if (table == nullptr) {
+		return true;
+	}
+
+	auto item = table->codes.find(&point);
+	if (item == table->codes.end()) {
+		return true;
+	}
+
+	// Index 0 keeps error code of point
+	const std::vector<int> & codes = item->second;
+	const std::size_t choices = codes.size() + 1;
+
+	unsigned int bits = 0;
+	while ((std::size_t{1} << bits) < choices) {
+		++bits;
+	}
+
+	std::uint32_t index = 0;
+	if (takeBits(state, bits, index) && ((index % choices) != 0)) {
+		thread_fuzz_point = &point;
+		thread_fuzz_session = FAULT_INJECTION_READ(&state.id);
+		thread_fuzz_code = codes[index % choices - 1];
+	}
+
+	return true;
+}
+
+bool avm::fault_injection::startFuzzing(const std::uint8_t * data, std::size_t size)
+{
+	session_state_t & state = *getSessionState();
+
+	if (FAULT_INJECTION_READ(&state.session) != detail::session_t::fuzz) {
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		if (!startSession(state, detail::session_t::fuzz)) {
+			return false;
+		}
+	}
+
+	// Disable fuzzing while input is changed
+	FAULT_INJECTION_WRITE(&state.fuzz_bits, std::size_t{0});
+	state.fuzz_data = data;
+	FAULT_INJECTION_WRITE(&state.fuzz_position, std::size_t{0});
+	FAULT_INJECTION_WRITE(&state.fuzz_bits, size * 8);
+
+	return true;
+}
+
+void avm::fault_injection::stopFuzzing()
+{
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (FAULT_INJECTION_READ(&state.session) != detail::session_t::fuzz) {
+		return;
+	}
+
+	FAULT_INJECTION_WRITE(&state.session, detail::session_t::none);
+	FAULT_INJECTION_WRITE(&state.fuzz_bits, std::size_t{0});
+	state.fuzz_data = nullptr;
+}
+
+void avm::fault_injection::setFuzzErrorCodes(point_t & point, const int * codes, std::size_t count)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	session_state_t & state = *getSessionState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	std::unique_ptr<detail::fuzz_codes_t> table{new detail::fuzz_codes_t{}};
+	if (state.fuzz_codes != nullptr) {
+		table->codes = state.fuzz_codes->codes;
+	}
+
+	if (count == 0) {
+		table->codes.erase(&point);
+	} else {
+		table->codes[&point].assign(codes, codes + count);
+	}
+
+	const detail::fuzz_codes_t * published = nullptr;
+	if (!table->codes.empty()) {
+		published = table.get();
+		state.fuzz_tables.push_back(std::move(table));
+	}
+
+	FAULT_INJECTION_WRITE(&state.fuzz_codes, published);
+}
+
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		struct statistics_state_t
+		{
+			std::mutex mutex;
+			statistics_header_t * header;
+			std::size_t length;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::statistics_state_t * getStatisticsState()
+	{
+		static detail::statistics_state_t state{};
+
+		return &state;
+	}
+}
+
+namespace
+{
+	using avm::fault_injection::detail::statistics_header_t;
+	using avm::fault_injection::detail::statistics_slot_t;
+
+	std::uint64_t wallNow()
+	{
+		struct timespec now;
+
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		return static_cast<std::uint64_t>(now.tv_sec) * 1000000000u + static_cast<std::uint64_t>(now.tv_nsec);
+	}
+
+	void assignSlot(statistics_header_t & header, avm::fault_injection::point_t & point)
+	{
+		using namespace avm::fault_injection;
+
+		if ((getPointVersion(point) < 2) || (FAULT_INJECTION_READ(&point.versions.v2.statistics) != nullptr)) {
+			return;
+		}
+
+		const std::uint32_t index = FAULT_INJECTION_READ(&header.size);
+		if (index >= header.capacity) {
+			return;
+		}
+
+		statistics_slot_t & slot = reinterpret_cast<statistics_slot_t *>(&header + 1)[index];
+		strncpy(slot.space, getSpace(point), sizeof(slot.space) - 1);
+		strncpy(slot.name, getName(point), sizeof(slot.name) - 1);
+
+		FAULT_INJECTION_WRITE(&header.size, index + 1);
+		FAULT_INJECTION_WRITE(&point.versions.v2.statistics, &slot);
+	}
+}
+
+void avm::fault_injection::detail::attachStatistics(module_points_t * points)
+{
+	statistics_state_t & state = *getStatisticsState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (state.header == nullptr) {
+		return;
+	}
+
+	for (point_t ** item = points->begin; item != points->end; ++item) {
+		if (*item != nullptr) {
+			assignSlot(*state.header, **item);
+		}
+	}
+}
+
+void avm::fault_injection::detail::count(statistics_slot_t & slot, bool triggered)
+{
+	FAULT_INJECTION_FETCH_ADD(&slot.evaluated, std::uint64_t{1});
+
+	if (triggered) {
+		FAULT_INJECTION_FETCH_ADD(&slot.triggered, std::uint64_t{1});
+		FAULT_INJECTION_WRITE(&slot.last_triggered, wallNow());
+	}
+}
+
+bool avm::fault_injection::startStatistics(const char * path, std::uint32_t capacity)
+{
+	detail::statistics_state_t & state = *getStatisticsState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (state.header != nullptr) {
+		return false;
+	}
+
+	const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		return false;
+	}
+
+	const std::size_t length = sizeof(statistics_header_t) + sizeof(statistics_slot_t) * capacity;
+
+	void * data = MAP_FAILED;
+	if (ftruncate(fd, static_cast<off_t>(length)) == 0) {
+		data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	// Pages of shared file mapping stay in page cache when process
+	// is killed
+	statistics_header_t * header = static_cast<statistics_header_t *>(data);
+	memcpy(header->magic, detail::statistics_magic, sizeof(header->magic));
+	header->version = detail::statistics_version;
+	header->capacity = capacity;
+
+	for (point_t & point : points) {
+		assignSlot(*header, point);
+	}
+
+	state.header = header;
+	state.length = length;
+
+	return true;
+}
+
+void avm::fault_injection::stopStatistics()
+{
+	detail::statistics_state_t & state = *getStatisticsState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (state.header == nullptr) {
+		return;
+	}
+
+	for (point_t & point : points) {
+		if (getPointVersion(point) >= 2) {
+			FAULT_INJECTION_WRITE(&point.versions.v2.statistics, static_cast<detail::statistics_slot_t *>(nullptr));
+		}
+	}
+
+	munmap(state.header, state.length);
+	state.header = nullptr;
+	state.length = 0;
+}
+
+namespace avm::fault_injection
+{
+	namespace detail
+	{
+		// Immutable once published to point
+		struct exception_t
+		{
+			std::exception_ptr exception;
+		};
+
+		struct exception_state_t
+		{
+			std::mutex mutex;
+			// Published holders are kept until exit since injection
+			// sites read them without lock
+			std::vector<std::unique_ptr<exception_t>> holders;
+		};
+	}
+
+	FAULT_INJECTION_STATE
+	detail::exception_state_t * getExceptionState()
+	{
+		static detail::exception_state_t state{};
+
+		return &state;
+	}
+}
+
+#if defined(__cpp_exceptions)
+void avm::fault_injection::detail::rethrowException(const point_t & point)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	if (const exception_t * holder = FAULT_INJECTION_READ(&point.versions.v2.exception)) {
+		std::rethrow_exception(holder->exception);
+	}
+}
+
+void avm::fault_injection::setException(point_t & point, std::exception_ptr exception)
+{
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	detail::exception_t * published = nullptr;
+	if (exception) {
+		detail::exception_state_t & state = *getExceptionState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		state.holders.emplace_back(new detail::exception_t{std::move(exception)});
+		published = state.holders.back().get();
+	}
+
+	FAULT_INJECTION_WRITE(&point.versions.v2.exception, published);
+}
+#endif
+
+avm::fault_injection::site_t * avm::fault_injection::findSite(const char * file, unsigned int line)
+{
+	const std::size_t length = strlen(file);
+	site_t * result = nullptr;
+
+	forEachSite([&](site_t & site) {
+		if ((result != nullptr) || (site.line != line)) {
+			return;
+		}
+
+		const std::size_t site_length = strlen(site.file);
+		if ((site_length < length) || (strcmp(site.file + site_length - length, file) != 0)) {
+			return;
+		}
+
+		if ((site_length == length) || (site.file[site_length - length - 1] == '/')) {
+			result = &site;
+		}
+	});
+
+	return result;
+}
+
+void avm::fault_injection::activateSite(site_t & site, mode_t mode)
+{
+	point_t & point = *site.point;
+
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	bool selected = false;
+	if (FAULT_INJECTION_CAS(&site.selected, &selected, true)) {
+		FAULT_INJECTION_FETCH_ADD(&point.versions.v2.selected_sites, 1u);
+	}
+
+	detail::enable(point, mode);
+}
+
+void avm::fault_injection::deactivateSite(site_t & site)
+{
+	point_t & point = *site.point;
+
+	if (getPointVersion(point) < 2) {
+		return;
+	}
+
+	bool selected = true;
+	// Adding maximal value decrements counter
+	if (FAULT_INJECTION_CAS(&site.selected, &selected, false)
+	    && (FAULT_INJECTION_FETCH_ADD(&point.versions.v2.selected_sites, std::numeric_limits<std::uint32_t>::max()) == 0)) {
+		deactivate(point);
+	}
+}
+
+void avm::fault_injection::detail::clearSites(point_t & point)
+{
+	forEachSite(point, [&point](site_t & site) {
+		bool selected = true;
+		// Adding maximal value decrements counter
+		if (FAULT_INJECTION_CAS(&site.selected, &selected, false)) {
+			FAULT_INJECTION_FETCH_ADD(&point.versions.v2.selected_sites, std::numeric_limits<std::uint32_t>::max());
+		}
+	});
+}
+
+#if !defined(FAULT_INJECTION_SHARED)
+void avm::fault_injection::registerModule()
+{
+	if (!fault_injections.registered) {
+		avm::fault_injection::registerModuleImpl(&fault_injections);
+	}
+	avm::fault_injection::registerSitesImpl(&fault_injection_sites);
+}
+#endif
+
 __attribute__((used,constructor))
 static void init()
 {
@@ -0,0 +1,352 @@
+// -*- compile-command: "cd .. && make test" -*-
+#include <fault_injection_alloc.hpp>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <limits>
+#include <new>
+
+FAULT_INJECTION_POINT_EX(alloc, malloc, "Fail malloc()", ENOMEM);
+FAULT_INJECTION_POINT_EX(alloc, calloc, "Fail calloc()", ENOMEM);
+FAULT_INJECTION_POINT_EX(alloc, realloc, "Fail realloc()", ENOMEM);
+FAULT_INJECTION_POINT_EX(alloc, posix_memalign, "Fail posix_memalign()", ENOMEM);
+FAULT_INJECTION_POINT(alloc, operator_new, "Fail global operator new");
+
+#if defined(__APPLE__)
+// Interposing works only when the module is loaded as dynamic library,
+// calls to original functions from this module are not interposed.
+#define FAULT_INJECTION_HOOK(function) fault_injection_##function
+#define FAULT_INJECTION_INTERPOSE(function) \
+	__attribute__((used)) static const struct { \
+		const void * replacement; \
+		const void * replacee; \
+	} interpose_##function __attribute__((section("__DATA,__interpose"))) = { \
+		reinterpret_cast<const void *>(&FAULT_INJECTION_HOOK(function)), \
+		reinterpret_cast<const void *>(&function) \
+	}
+
+static inline void * realMalloc(size_t size)
+{
+	return malloc(size);
+}
+
+static inline void * realCalloc(size_t count, size_t size)
+{
+	return calloc(count, size);
+}
+
+static inline void * realRealloc(void * ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+static inline int realPosixMemalign(void ** ptr, size_t alignment, size_t size)
+{
+	return posix_memalign(ptr, alignment, size);
+}
+#elif defined(__linux__)
+#define FAULT_INJECTION_HOOK(function) function
+#define FAULT_INJECTION_INTERPOSE(function) static_assert(true, "")
+
+extern "C" {
+	void * __libc_malloc(size_t size);
+	void * __libc_calloc(size_t count, size_t size);
+	void * __libc_realloc(void * ptr, size_t size);
+	void * __libc_memalign(size_t alignment, size_t size);
+}
+
+static inline void * realMalloc(size_t size)
+{
+	return __libc_malloc(size);
+}
+
+static inline void * realCalloc(size_t count, size_t size)
+{
+	return __libc_calloc(count, size);
+}
+
+static inline void * realRealloc(void * ptr, size_t size)
+{
+	return __libc_realloc(ptr, size);
+}
+
+static inline int realPosixMemalign(void ** ptr, size_t alignment, size_t size)
+{
+	if ((alignment == 0) || (alignment % sizeof(void *) != 0) || ((alignment & (alignment - 1)) != 0)) {
+		return EINVAL;
+	}
+
+	void * result = __libc_memalign(alignment, size);
+	if (result == nullptr) {
+		return ENOMEM;
+	}
+
+	*ptr = result;
+
+	return 0;
+}
+#else
+#error "Unsupported platform"
+#endif
+
+namespace
+{
+	struct allocator_hook_t
+	{
+		avm::fault_injection::point_t & point;
+		std::uint64_t nth;
+		std::size_t min_size;
+		// Probability scaled to 2^32
+		std::uint64_t threshold;
+		std::uint64_t counter;
+	};
+
+	constexpr std::uint64_t always = std::uint64_t{1} << 32;
+
+	allocator_hook_t hooks[] = {
+		{ FAULT_INJECTION_POINT_REF(alloc, malloc), 0, 0, always, 0 },
+		{ FAULT_INJECTION_POINT_REF(alloc, calloc), 0, 0, always, 0 },
+		{ FAULT_INJECTION_POINT_REF(alloc, realloc), 0, 0, always, 0 },
+		{ FAULT_INJECTION_POINT_REF(alloc, posix_memalign), 0, 0, always, 0 },
+		{ FAULT_INJECTION_POINT_REF(alloc, operator_new), 0, 0, always, 0 },
+	};
+
+	std::uint64_t random_state = 0;
+
+	// SplitMix64 over shared counter doesn't require thread local
+	// storage which can allocate on first access
+	std::uint32_t nextRandom()
+	{
+		std::uint64_t value = FAULT_INJECTION_FETCH_ADD(&random_state, 0x9e3779b97f4a7c15ull);
+
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+
+		return static_cast<std::uint32_t>((value ^ (value >> 31)) >> 32);
+	}
+
+	// Evaluated only when point is active
+	bool shouldFail(avm::fault_injection::alloc::function_t function, std::size_t size)
+	{
+		allocator_hook_t & hook = hooks[static_cast<std::size_t>(function)];
+
+		if (size < FAULT_INJECTION_READ(&hook.min_size)) {
+			return false;
+		}
+
+		const std::uint64_t nth = FAULT_INJECTION_READ(&hook.nth);
+		if ((nth != 0) && (FAULT_INJECTION_FETCH_ADD(&hook.counter, 1) % nth != 0)) {
+			return false;
+		}
+
+		const std::uint64_t threshold = FAULT_INJECTION_READ(&hook.threshold);
+
+		return (threshold >= always) || (nextRandom() < threshold);
+	}
+
+	void * allocate(std::size_t size, std::size_t alignment)
+	{
+		using avm::fault_injection::alloc::function_t;
+
+		if (size == 0) {
+			size = 1;
+		}
+
+		FAULT_INJECT_EXCEPTION_IF(alloc, operator_new, shouldFail(function_t::operator_new, size), std::bad_alloc());
+
+		while (true) {
+			void * result = nullptr;
+
+			if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+				result = realMalloc(size);
+			} else if (realPosixMemalign(&result, alignment, size) != 0) {
+				result = nullptr;
+			}
+
+			if (result != nullptr) {
+				return result;
+			}
+
+			std::new_handler handler = std::get_new_handler();
+			if (handler == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			handler();
+		}
+	}
+}
+
+avm::fault_injection::point_t & avm::fault_injection::alloc::getPoint(function_t function)
+{
+	return hooks[static_cast<std::size_t>(function)].point;
+}
+
+void avm::fault_injection::alloc::setPolicy(function_t function, const policy_t & policy)
+{
+	allocator_hook_t & hook = hooks[static_cast<std::size_t>(function)];
+
+	std::uint64_t threshold = always;
+	if (policy.probability <= 0.0) {
+		threshold = 0;
+	} else if (policy.probability < 1.0) {
+		threshold = static_cast<std::uint64_t>(policy.probability * static_cast<double>(always));
+	}
+
+	FAULT_INJECTION_WRITE(&hook.counter, std::uint64_t{0});
+	FAULT_INJECTION_WRITE(&hook.nth, policy.nth);
+	FAULT_INJECTION_WRITE(&hook.min_size, policy.min_size);
+	FAULT_INJECTION_WRITE(&hook.threshold, threshold);
+}
+
+avm::fault_injection::alloc::policy_t avm::fault_injection::alloc::getPolicy(function_t function)
+{
+	const allocator_hook_t & hook = hooks[static_cast<std::size_t>(function)];
+	const std::uint64_t threshold = FAULT_INJECTION_READ(&hook.threshold);
+
+	return policy_t{
+		FAULT_INJECTION_READ(&hook.nth),
+		FAULT_INJECTION_READ(&hook.min_size),
+		(threshold >= always) ? 1.0 : static_cast<double>(threshold) / static_cast<double>(always)
+	};
+}
+
+// Hook of enabled point is kept in cold function so inactive hook is
+// a single check followed by tail call of real function without
+// frame setup
+#define FAULT_INJECTION_HOOK_ENABLED(name) \
+	__builtin_expect(::avm::fault_injection::detail::current::isEnabled(FAULT_INJECTION_POINT_REF(alloc, name)), 0)
+
+namespace
+{
+	using avm::fault_injection::alloc::function_t;
+
+	__attribute__((noinline,cold))
+	void * enabledMalloc(size_t size)
+	{
+		return FAULT_INJECT_ERRNO_IF_EX(alloc, malloc, shouldFail(function_t::malloc, size), realMalloc(size), nullptr);
+	}
+
+	__attribute__((noinline,cold))
+	void * enabledCalloc(size_t count, size_t size)
+	{
+		size_t total = 0;
+		if (__builtin_mul_overflow(count, size, &total)) {
+			total = std::numeric_limits<size_t>::max();
+		}
+
+		return FAULT_INJECT_ERRNO_IF_EX(alloc, calloc, shouldFail(function_t::calloc, total), realCalloc(count, size), nullptr);
+	}
+
+	__attribute__((noinline,cold))
+	void * enabledRealloc(void * ptr, size_t size)
+	{
+		return FAULT_INJECT_ERRNO_IF_EX(alloc, realloc, shouldFail(function_t::realloc, size), realRealloc(ptr, size), nullptr);
+	}
+
+	__attribute__((noinline,cold))
+	int enabledPosixMemalign(void ** ptr, size_t alignment, size_t size)
+	{
+		return FAULT_INJECT_ERROR_CODE_IF(alloc, posix_memalign, shouldFail(function_t::posix_memalign, size), realPosixMemalign(ptr, alignment, size));
+	}
+}
+
+extern "C" {
+	void * FAULT_INJECTION_HOOK(malloc)(size_t size)
+	{
+		if (FAULT_INJECTION_HOOK_ENABLED(malloc)) {
+			return enabledMalloc(size);
+		}
+
+		return realMalloc(size);
+	}
+
+	void * FAULT_INJECTION_HOOK(calloc)(size_t count, size_t size)
+	{
+		if (FAULT_INJECTION_HOOK_ENABLED(calloc)) {
+			return enabledCalloc(count, size);
+		}
+
+		return realCalloc(count, size);
+	}
+
+	void * FAULT_INJECTION_HOOK(realloc)(void * ptr, size_t size)
+	{
+		if (FAULT_INJECTION_HOOK_ENABLED(realloc)) {
+			return enabledRealloc(ptr, size);
+		}
+
+		return realRealloc(ptr, size);
+	}
+
+	int FAULT_INJECTION_HOOK(posix_memalign)(void ** ptr, size_t alignment, size_t size)
+	{
+		if (FAULT_INJECTION_HOOK_ENABLED(posix_memalign)) {
+			return enabledPosixMemalign(ptr, alignment, size);
+		}
+
+		return realPosixMemalign(ptr, alignment, size);
+	}
+}
+
+FAULT_INJECTION_INTERPOSE(malloc);
+FAULT_INJECTION_INTERPOSE(calloc);
+FAULT_INJECTION_INTERPOSE(realloc);
+FAULT_INJECTION_INTERPOSE(posix_memalign);
+
+void * operator new(std::size_t size)
+{
+	return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void * operator new[](std::size_t size)
+{
+	return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size, static_cast<std::size_t>(alignment));
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size, static_cast<std::size_t>(alignment));
+	} catch (...) {
+		return nullptr;
+	}
+}
@@ -0,0 +1,138 @@
+// -*- compile-command: "cd .. && make test" -*-
+// Representative injection sites checked by test/codegen.sh: code of
+// every function with injection is compared to its baseline
+// counterpart without injection.
+#include <errno.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <system_error>
+
+#include <fault_injection.hpp>
+
+FAULT_INJECTION_POINT(codegen, point, "Code generation");
+
+extern "C" {
+	// Defined elsewhere so the compiler can't fold calls
+	int work(int value);
+	std::size_t transfer(std::size_t size);
+	std::error_code check(int value);
+
+	int error_code_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int error_code_injected(int value)
+	{
+		return FAULT_INJECT_ERROR_CODE(codegen, point, work(value));
+	}
+
+	int error_code_if_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int error_code_if_injected(int value)
+	{
+		return FAULT_INJECT_ERROR_CODE_IF(codegen, point, value > 0, work(value));
+	}
+
+	int errno_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int errno_injected(int value)
+	{
+		return FAULT_INJECT_ERRNO(codegen, point, work(value));
+	}
+
+	int errno_ex_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int errno_ex_injected(int value)
+	{
+		return FAULT_INJECT_ERRNO_EX(codegen, point, work(value), -2);
+	}
+
+	int value_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int value_injected(int value)
+	{
+		return FAULT_INJECT_VALUE(codegen, point, work(value));
+	}
+
+	std::error_code error_baseline(int value)
+	{
+		return check(value);
+	}
+
+	std::error_code error_injected(int value)
+	{
+		return FAULT_INJECT_ERROR(codegen, point, check(value));
+	}
+
+	int exception_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int exception_injected(int value)
+	{
+		FAULT_INJECT_EXCEPTION(codegen, point, std::runtime_error("injected"));
+
+		return work(value);
+	}
+
+	int action_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int action_injected(int value)
+	{
+		FAULT_INJECT_ACTION(codegen, point, value = -1);
+
+		return work(value);
+	}
+
+	int hook_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int hook_injected(int value)
+	{
+		FAULT_INJECT_HOOK(codegen, point, &value);
+
+		return work(value);
+	}
+
+	int perturbation_baseline(int value)
+	{
+		return work(value);
+	}
+
+	int perturbation_injected(int value)
+	{
+		FAULT_INJECT_PERTURBATION(codegen, point);
+
+		return work(value);
+	}
+
+	std::size_t io_size_baseline(std::size_t size)
+	{
+		return transfer(size);
+	}
+
+	std::size_t io_size_injected(std::size_t size)
+	{
+		return transfer(FAULT_INJECT_IO_SIZE(codegen, point, size));
+	}
+}
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Checks code generated for injection sites from test/codegen.cpp:
+# with disabled injection every site should be identical to its
+# baseline, with enabled injection the inactive path of site (active
+# path is moved to cold section) should add at most LIMIT (16)
+# instructions. With injection enabled but its space turned off every
+# site should be identical to the disabled build.
+#
+# Usage: codegen.sh DISABLED_OBJECT ENABLED_OBJECT [SPACE_DISABLED_OBJECT]
+
+set -e
+
+OBJDUMP=${OBJDUMP:-objdump}
+NM=${NM:-nm}
+
+disabled=$1
+enabled=$2
+space_disabled=$3
+limit=${LIMIT:-16}
+
+# Prints instructions of function without addresses, branch targets
+# and alignment padding
+body() {
+	"$OBJDUMP" -d --no-show-raw-insn "$1" | awk -v name="<$2>:" '
+		$2 == name { found = 1; next }
+		found && (NF == 0) { exit }
+		found {
+			sub(/^ *[0-9a-f]+:[ \t]*/, "")
+			sub(/[ \t]*#.*$/, "")
+			gsub(/[0-9a-f]+ <[^>]*>/, "<target>")
+			if ($0 !~ /^(nop|xchg +%ax,%ax|cs nop|data16|int3)/) {
+				print
+			}
+		}'
+}
+
+sites=$("$NM" "$enabled" | awk '$3 ~ /_injected$/ { sub(/_injected$/, "", $3); print $3 }')
+if [ -z "$sites" ]; then
+	echo "No injection sites found in $enabled" >&2
+	exit 1
+fi
+
+failed=0
+for site in $sites; do
+	if [ "$(body "$disabled" "${site}_injected")" != "$(body "$disabled" "${site}_baseline")" ]; then
+		echo "$site: disabled injection changes generated code:" >&2
+		body "$disabled" "${site}_injected" >&2
+		failed=1
+	fi
+
+	if [ -n "$space_disabled" ] && [ "$(body "$space_disabled" "${site}_injected")" != "$(body "$disabled" "${site}_injected")" ]; then
+		echo "$site: disabled space differs from disabled injection:" >&2
+		body "$space_disabled" "${site}_injected" >&2
+		failed=1
+	fi
+
+	injected=$(body "$enabled" "${site}_injected" | wc -l)
+	baseline=$(body "$enabled" "${site}_baseline" | wc -l)
+	added=$((injected - baseline))
+	if [ "$added" -gt "$limit" ]; then
+		echo "$site: inactive path adds $added instructions (limit $limit):" >&2
+		body "$enabled" "${site}_injected" >&2
+		failed=1
+	else
+		echo "$site: $added instructions"
+	fi
+done
+
+exit $failed
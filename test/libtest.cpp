@@ -20,6 +20,21 @@ namespace lib {
 #error "Unsupported platform"
 #endif
 
+// Version 1 point
+#if defined(__APPLE__)
+namespace lib {
+	::avm::fault_injection::v1::point_t fault_injection_point_point_v1 __attribute__((used)) = { 1, "lib", "point_v1", "Point version 1", 0, false, ::avm::fault_injection::mode_t::multiple };
+	static ::avm::fault_injection::point_t * fault_injection_point_point_v1_ptr __attribute__((used,section("__DATA,__faults"))) = reinterpret_cast<::avm::fault_injection::point_t *>(&fault_injection_point_point_v1);
+}
+#elif defined(__linux__)
+namespace lib {
+	::avm::fault_injection::v1::point_t fault_injection_point_point_v1 __attribute__((used)) = { 1, "lib", "point_v1", "Point version 1", 0, false, ::avm::fault_injection::mode_t::multiple };
+	static ::avm::fault_injection::point_t * fault_injection_point_point_v1_ptr __attribute__((used,section("__faults"))) = reinterpret_cast<::avm::fault_injection::point_t *>(&fault_injection_point_point_v1);
+}
+#else
+#error "Unsupported platform"
+#endif
+
 void executeWithInjection()
 {
 	FAULT_INJECT_EXCEPTION(lib, point1, std::runtime_error("INJECTED"));
@@ -37,6 +52,14 @@ void executeV0WithInjection()
 	}
 }
 
+void executeV1WithInjection()
+{
+	// Code manually
+	if (FAULT_INJECTION_READ(&lib::fault_injection_point_point_v1.active)) {
+		throw std::runtime_error("INJECTED");
+	}
+}
+
 __attribute__((used,constructor))
 static void init()
 {
@@ -0,0 +1,253 @@
+// -*- compile-command: "cd .. && make test" -*-
+#define BOOST_TEST_MODULE fault_injection_alloc
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <new>
+
+#include <fault_injection_alloc.hpp>
+#include <fault_injection_test_helper.hpp>
+
+using avm::fault_injection::alloc::function_t;
+using avm::fault_injection::alloc::getPoint;
+using avm::fault_injection::alloc::policy_t;
+
+namespace
+{
+	// Restores default policy so failed checks don't break other test cases
+	class PolicyGuard
+	{
+	public:
+		PolicyGuard(function_t function, const policy_t & policy):
+			function_{function}
+		{
+			avm::fault_injection::alloc::setPolicy(function, policy);
+		}
+
+		~PolicyGuard()
+		{
+			avm::fault_injection::alloc::resetPolicy(function_);
+		}
+
+	private:
+		function_t function_;
+	};
+}
+
+BOOST_AUTO_TEST_SUITE(registration)
+
+BOOST_AUTO_TEST_CASE(points)
+{
+	BOOST_CHECK(avm::fault_injection::find("alloc", "malloc") == &getPoint(function_t::malloc));
+	BOOST_CHECK(avm::fault_injection::find("alloc", "calloc") == &getPoint(function_t::calloc));
+	BOOST_CHECK(avm::fault_injection::find("alloc", "realloc") == &getPoint(function_t::realloc));
+	BOOST_CHECK(avm::fault_injection::find("alloc", "posix_memalign") == &getPoint(function_t::posix_memalign));
+	BOOST_CHECK(avm::fault_injection::find("alloc", "operator_new") == &getPoint(function_t::operator_new));
+}
+
+BOOST_AUTO_TEST_CASE(policy)
+{
+	{
+		PolicyGuard policy(function_t::malloc, policy_t{5, 100, 0.5});
+
+		const policy_t value = avm::fault_injection::alloc::getPolicy(function_t::malloc);
+
+		BOOST_CHECK_EQUAL(value.nth, 5u);
+		BOOST_CHECK_EQUAL(value.min_size, 100u);
+		BOOST_CHECK_CLOSE(value.probability, 0.5, 0.0001);
+	}
+
+	const policy_t value = avm::fault_injection::alloc::getPolicy(function_t::malloc);
+
+	BOOST_CHECK_EQUAL(value.nth, 0u);
+	BOOST_CHECK_EQUAL(value.min_size, 0u);
+	BOOST_CHECK_EQUAL(value.probability, 1.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(c_functions)
+
+BOOST_AUTO_TEST_CASE(no_error)
+{
+	void * ptr = malloc(16);
+
+	BOOST_CHECK(ptr != nullptr);
+
+	free(ptr);
+}
+
+BOOST_AUTO_TEST_CASE(malloc_oneshot)
+{
+	void * ptr1 = nullptr;
+	void * ptr2 = nullptr;
+	int error = 0;
+	{
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::malloc), avm::fault_injection::mode_t::oneshot);
+
+		errno = 0;
+		ptr1 = malloc(16);
+		error = errno;
+		ptr2 = malloc(16);
+	}
+
+	BOOST_CHECK(ptr1 == nullptr);
+	BOOST_CHECK_EQUAL(error, ENOMEM);
+	BOOST_CHECK(ptr2 != nullptr);
+
+	free(ptr2);
+}
+
+BOOST_AUTO_TEST_CASE(malloc_min_size)
+{
+	void * small = nullptr;
+	void * large = nullptr;
+	{
+		PolicyGuard policy(function_t::malloc, policy_t{0, 1 << 20, 1.0});
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::malloc));
+
+		small = malloc(16);
+		large = malloc(2 << 20);
+	}
+
+	BOOST_CHECK(small != nullptr);
+	BOOST_CHECK(large == nullptr);
+
+	free(small);
+}
+
+BOOST_AUTO_TEST_CASE(malloc_nth)
+{
+	void * ptrs[6] = {};
+	{
+		PolicyGuard policy(function_t::malloc, policy_t{3, 0, 1.0});
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::malloc));
+
+		for (void *& ptr : ptrs) {
+			ptr = malloc(16);
+		}
+	}
+
+	BOOST_CHECK(ptrs[0] != nullptr);
+	BOOST_CHECK(ptrs[1] != nullptr);
+	BOOST_CHECK(ptrs[2] == nullptr);
+	BOOST_CHECK(ptrs[3] != nullptr);
+	BOOST_CHECK(ptrs[4] != nullptr);
+	BOOST_CHECK(ptrs[5] == nullptr);
+
+	for (void * ptr : ptrs) {
+		free(ptr);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(malloc_probability_zero)
+{
+	void * ptrs[16] = {};
+	{
+		PolicyGuard policy(function_t::malloc, policy_t{0, 0, 0.0});
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::malloc));
+
+		for (void *& ptr : ptrs) {
+			ptr = malloc(16);
+		}
+	}
+
+	for (void * ptr : ptrs) {
+		BOOST_CHECK(ptr != nullptr);
+		free(ptr);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(calloc_error)
+{
+	void * ptr = nullptr;
+	int error = 0;
+	{
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::calloc), avm::fault_injection::mode_t::oneshot);
+
+		errno = 0;
+		ptr = calloc(4, 4);
+		error = errno;
+	}
+
+	BOOST_CHECK(ptr == nullptr);
+	BOOST_CHECK_EQUAL(error, ENOMEM);
+}
+
+BOOST_AUTO_TEST_CASE(realloc_error)
+{
+	void * ptr = malloc(16);
+	void * result = nullptr;
+	{
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::realloc), avm::fault_injection::mode_t::oneshot);
+
+		result = realloc(ptr, 32);
+	}
+
+	BOOST_CHECK(result == nullptr);
+
+	free(ptr);
+}
+
+BOOST_AUTO_TEST_CASE(posix_memalign_error)
+{
+	void * ptr = nullptr;
+	int result = 0;
+	{
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::posix_memalign), avm::fault_injection::mode_t::oneshot);
+
+		result = posix_memalign(&ptr, 64, 128);
+	}
+
+	BOOST_CHECK_EQUAL(result, ENOMEM);
+	BOOST_CHECK(ptr == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(operator_new)
+
+BOOST_AUTO_TEST_CASE(no_error)
+{
+	int * value = new int{5};
+
+	BOOST_CHECK_EQUAL(*value, 5);
+
+	delete value;
+}
+
+BOOST_AUTO_TEST_CASE(error)
+{
+	bool thrown = false;
+	{
+		PolicyGuard policy(function_t::operator_new, policy_t{0, 1 << 20, 1.0});
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::operator_new));
+
+		try {
+			char * buffer = new char[2 << 20];
+			delete[] buffer;
+		} catch (const std::bad_alloc &) {
+			thrown = true;
+		}
+	}
+
+	BOOST_CHECK(thrown);
+}
+
+BOOST_AUTO_TEST_CASE(error_nothrow)
+{
+	char * buffer = nullptr;
+	{
+		PolicyGuard policy(function_t::operator_new, policy_t{0, 1 << 20, 1.0});
+		avm::fault_injection::InjectionStateGuard guard(getPoint(function_t::operator_new));
+
+		buffer = new (std::nothrow) char[2 << 20];
+	}
+
+	BOOST_CHECK(buffer == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,7 @@ FAULT_INJECTION_POINT(test, point2, "Point 2");
 
 void executeWithInjection();
 void executeV0WithInjection();
+void executeV1WithInjection();
 
 static bool isInjected(const std::exception & e)
 {
@@ -28,7 +29,7 @@ BOOST_AUTO_TEST_CASE(foreach)
 {
 	  using avm::fault_injection::points;
 
-	  BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 2u);
+	  BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 3u);
 
 	  BOOST_CHECK(std::find_if(points.begin(), points.end(), [](const auto & point) {
 		  return (strcmp(getSpace(point), "test") == 0) && (strcmp(getName(point), "point1") == 0);
@@ -182,6 +183,30 @@ BOOST_AUTO_TEST_CASE(error_custom_ex)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(disabled_value)
+
+BOOST_AUTO_TEST_CASE(no_error)
+{
+	const long value = FAULT_INJECT_VALUE(test, point1, 15L);
+
+	BOOST_CHECK_EQUAL(value, 15L);
+}
+
+BOOST_AUTO_TEST_CASE(error)
+{
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(test, point1));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, point1), 5L);
+
+	const long value = FAULT_INJECT_VALUE(test, point1, 15L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, point1));
+	avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(test, point1));
+
+	BOOST_CHECK_EQUAL(value, 15L);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(disabled_exception)
 
 BOOST_AUTO_TEST_CASE(no_error)
@@ -221,6 +246,42 @@ BOOST_AUTO_TEST_CASE(with_action)
 	BOOST_CHECK(!invoked);
 }
 
+BOOST_AUTO_TEST_CASE(with_action_multi_guard)
+{
+	bool invoked = false;
+	avm::fault_injection::MultiInjectionStateGuard guard{
+		{FAULT_INJECTION_POINT_REF(test, point1), -10},
+		{FAULT_INJECTION_POINT_REF(test, point2), avm::fault_injection::mode_t::oneshot},
+	};
+
+	FAULT_INJECT_ACTION(test, point1, do { invoked = true } while (false));
+
+	BOOST_CHECK(!invoked);
+	BOOST_CHECK_EQUAL(guard.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(disabled_hook)
+
+static void corrupt(avm::fault_injection::point_t &, void * context, void *)
+{
+	++*static_cast<int *>(context);
+}
+
+BOOST_AUTO_TEST_CASE(with_hook)
+{
+	int calls = 0;
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, point1));
+	avm::fault_injection::installHook(FAULT_INJECTION_POINT_REF(test, point1), corrupt, &calls);
+
+	FAULT_INJECT_HOOK(test, point1, nullptr);
+
+	avm::fault_injection::removeHook(FAULT_INJECTION_POINT_REF(test, point1));
+
+	BOOST_CHECK_EQUAL(calls, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(shared_lib)
@@ -235,6 +296,11 @@ BOOST_AUTO_TEST_CASE(no_error_v0)
 	BOOST_CHECK_NO_THROW(executeV0WithInjection());
 }
 
+BOOST_AUTO_TEST_CASE(no_error_v1)
+{
+	BOOST_CHECK_NO_THROW(executeV1WithInjection());
+}
+
 BOOST_AUTO_TEST_CASE(error)
 {
 	avm::fault_injection::activate("lib", "point1");
@@ -253,4 +319,21 @@ BOOST_AUTO_TEST_CASE(error_v0)
 	avm::fault_injection::deactivate("lib", "point_v0");
 }
 
+BOOST_AUTO_TEST_CASE(error_v1)
+{
+	avm::fault_injection::activate("lib", "point_v1");
+
+	BOOST_CHECK_EXCEPTION(executeV1WithInjection(), std::runtime_error, isInjected);
+
+	avm::fault_injection::deactivate("lib", "point_v1");
+}
+
+BOOST_AUTO_TEST_CASE(value_v1)
+{
+	avm::fault_injection::setValue("lib", "point_v1", 5);
+
+	BOOST_CHECK(!avm::fault_injection::hasValue("lib", "point_v1"));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getValue<int>("lib", "point_v1", 7), 7);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
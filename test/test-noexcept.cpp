@@ -0,0 +1,146 @@
+// -*- compile-command: "cd .. && make test-noexcept" -*-
+// Built with -fno-exceptions -fno-rtti, Boost.Test requires exceptions
+// so checks are reported by the test itself
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <system_error>
+
+#include <fault_injection.hpp>
+#include <fault_injection_test_helper.hpp>
+
+FAULT_INJECTION_POINT_EX(latency, read, "Read", EIO);
+FAULT_INJECTION_POINT(latency, flag, "Flag");
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: check %s failed\n", __FILE__, __LINE__, #condition); \
+			++failures; \
+		} \
+	} while (false)
+
+namespace
+{
+	struct result_t
+	{
+		result_t(int value): value{value} {}
+		result_t(std::error_code error): error{error} {}
+
+		int value = 0;
+		std::error_code error;
+	};
+
+	std::error_code read()
+	{
+		return FAULT_INJECT_ERROR(latency, read, std::error_code());
+	}
+
+	result_t readValue(int value)
+	{
+		return FAULT_INJECT_ERROR(latency, read, result_t{value});
+	}
+
+	void error()
+	{
+		CHECK(!read());
+		{
+			avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, read));
+
+			CHECK(read() == std::errc::io_error);
+		}
+		CHECK(!read());
+	}
+
+	void errorResult()
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, read), avm::fault_injection::mode_t::oneshot);
+
+		const result_t value1 = readValue(15);
+		const result_t value2 = readValue(16);
+
+		CHECK(value1.error == std::errc::io_error);
+		CHECK(!value2.error);
+		CHECK(value2.value == 16);
+	}
+
+	void errorCode()
+	{
+		avm::fault_injection::activate("latency", "read");
+
+		const int value = FAULT_INJECT_ERROR_CODE(latency, read, 0);
+
+		avm::fault_injection::deactivate("latency", "read");
+
+		CHECK(value == EIO);
+	}
+
+	void errnoCode()
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, read));
+
+		errno = 0;
+		const int value = FAULT_INJECT_ERRNO(latency, read, 0);
+
+		CHECK(value == -1);
+		CHECK(errno == EIO);
+	}
+
+	void action()
+	{
+		bool called = false;
+		{
+			avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, flag));
+
+			FAULT_INJECT_ACTION(latency, flag, called = true);
+		}
+
+		CHECK(called);
+	}
+
+	void record()
+	{
+		CHECK(avm::fault_injection::startRecording());
+		{
+			avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, read));
+
+			CHECK(read() == std::errc::io_error);
+		}
+
+		char path[] = "/tmp/fault_injection_noexcept.XXXXXX";
+		close(mkstemp(path));
+
+		CHECK(avm::fault_injection::stopRecording(path));
+		CHECK(avm::fault_injection::startReplay(path));
+		{
+			avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(latency, read));
+
+			CHECK(read() == std::errc::io_error);
+		}
+		avm::fault_injection::stopReplay();
+
+		unlink(path);
+	}
+}
+
+int main()
+{
+	error();
+	errorResult();
+	errorCode();
+	errnoCode();
+	action();
+	record();
+
+	if (failures != 0) {
+		std::fprintf(stderr, "%d failures detected\n", failures);
+		return 1;
+	}
+
+	std::printf("*** No errors detected\n");
+
+	return 0;
+}
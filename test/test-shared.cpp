@@ -9,12 +9,21 @@
 #include <stdexcept>
 
 #include <fault_injection.hpp>
+#include <fault_injection_test_helper.hpp>
 
 FAULT_INJECTION_POINT(test, point1, "Point 1");
 FAULT_INJECTION_POINT(test, point2, "Point 2");
 
 void executeWithInjection();
 void executeV0WithInjection();
+void executeV1WithInjection();
+
+// Required when runtime is used as shared library
+__attribute__((used,constructor))
+static void init()
+{
+	FAULT_INJECTION_REGISTER_MODULE();
+}
 
 static bool isInjected(const std::exception & e)
 {
@@ -85,7 +94,7 @@ BOOST_AUTO_TEST_CASE(foreach)
 {
 	  using avm::fault_injection::points;
 
-	  BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 4u);
+	  BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 5u);
 
 	  BOOST_CHECK(std::find_if(points.begin(), points.end(), [](const auto & point) {
 		  return (strcmp(getSpace(point), "test") == 0) && (strcmp(getName(point), "point1") == 0);
@@ -112,6 +121,17 @@ BOOST_AUTO_TEST_CASE(move_beyond_the_end)
 	BOOST_CHECK(it == points.end());
 }
 
+BOOST_AUTO_TEST_CASE(view)
+{
+	using namespace avm::fault_injection;
+
+	const points_view view = getPointsView();
+
+	BOOST_CHECK_EQUAL(view.size(), 5u);
+	BOOST_CHECK(std::find(view.begin(), view.end(), find("lib", "point_v1")) != view.end());
+	BOOST_CHECK(std::find(view.begin(), view.end(), &FAULT_INJECTION_POINT_REF(test, point1)) != view.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(error_code)
@@ -285,6 +305,11 @@ BOOST_AUTO_TEST_CASE(no_error_v0)
 	BOOST_CHECK_NO_THROW(executeV0WithInjection());
 }
 
+BOOST_AUTO_TEST_CASE(no_error_v1)
+{
+	BOOST_CHECK_NO_THROW(executeV1WithInjection());
+}
+
 BOOST_AUTO_TEST_CASE(error)
 {
 	avm::fault_injection::activate("lib", "point1");
@@ -303,4 +328,132 @@ BOOST_AUTO_TEST_CASE(error_v0)
 	avm::fault_injection::deactivate("lib", "point_v0");
 }
 
+BOOST_AUTO_TEST_CASE(error_v1)
+{
+	avm::fault_injection::activate("lib", "point_v1");
+
+	BOOST_CHECK_EXCEPTION(executeV1WithInjection(), std::runtime_error, isInjected);
+
+	avm::fault_injection::deactivate("lib", "point_v1");
+}
+
+BOOST_AUTO_TEST_CASE(rate_limited_v1)
+{
+	avm::fault_injection::activate("lib", "point_v1", avm::fault_injection::mode_t::rate_limited);
+
+	BOOST_CHECK(avm::fault_injection::getMode("lib", "point_v1") == avm::fault_injection::mode_t::multiple);
+
+	avm::fault_injection::deactivate("lib", "point_v1");
+}
+
+BOOST_AUTO_TEST_CASE(snapshot)
+{
+	{
+		avm::fault_injection::RegistrySnapshot snapshot;
+
+		BOOST_CHECK_EQUAL(snapshot.size(), 5u);
+
+		avm::fault_injection::activate("lib", "point_v0");
+		avm::fault_injection::activate("lib", "point_v1");
+		avm::fault_injection::setErrorCode("lib", "point_v1", 5);
+		avm::fault_injection::activate("lib", "point1");
+	}
+
+	BOOST_CHECK(!avm::fault_injection::isActive("lib", "point_v0"));
+	BOOST_CHECK(!avm::fault_injection::isActive("lib", "point_v1"));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode("lib", "point_v1"), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive("lib", "point1"));
+}
+
+BOOST_AUTO_TEST_CASE(value_v1)
+{
+	avm::fault_injection::setValue("lib", "point_v1", 5);
+
+	BOOST_CHECK(!avm::fault_injection::hasValue("lib", "point_v1"));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getValue<int>("lib", "point_v1", 7), 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(site)
+
+BOOST_AUTO_TEST_CASE(other_module)
+{
+	avm::fault_injection::point_t * point = avm::fault_injection::find("lib", "point1");
+	avm::fault_injection::site_t * site = nullptr;
+
+	BOOST_REQUIRE(point != nullptr);
+
+	avm::fault_injection::forEachSite(*point, [&site](avm::fault_injection::site_t & item) {
+		site = &item;
+	});
+
+	BOOST_REQUIRE(site != nullptr);
+	BOOST_CHECK(std::strcmp(site->function, "executeWithInjection") == 0);
+
+	avm::fault_injection::resetCounters(*site);
+	avm::fault_injection::activateSite(*site);
+
+	BOOST_CHECK_EXCEPTION(executeWithInjection(), std::runtime_error, isInjected);
+
+	avm::fault_injection::deactivateSite(*site);
+
+	BOOST_CHECK(!avm::fault_injection::isActive(*point));
+	BOOST_CHECK_NO_THROW(executeWithInjection());
+	BOOST_CHECK_EQUAL(avm::fault_injection::getTriggered(*site), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(handle)
+
+BOOST_AUTO_TEST_CASE(other_module)
+{
+	const avm::fault_injection::point_handle handle("lib", "point1");
+
+	BOOST_CHECK(handle);
+	BOOST_CHECK(handle.get() == avm::fault_injection::find("lib", "point1"));
+	BOOST_CHECK(!handle.isActive());
+
+	avm::fault_injection::activate("lib", "point1");
+
+	BOOST_CHECK(handle.isActive());
+	BOOST_CHECK_EXCEPTION(executeWithInjection(), std::runtime_error, isInjected);
+
+	avm::fault_injection::deactivate(*handle.get());
+
+	BOOST_CHECK(!avm::fault_injection::isActive("lib", "point1"));
+}
+
+BOOST_AUTO_TEST_CASE(missing)
+{
+	const avm::fault_injection::point_handle handle("lib", "missing");
+	const avm::fault_injection::point_handle copy(handle);
+
+	BOOST_CHECK(!handle);
+	BOOST_CHECK(!copy.isActive());
+}
+
+#if defined(FAULT_INJECTION_SHARED)
+// Registers module permanently so it should be the last test case
+BOOST_AUTO_TEST_CASE(new_module)
+{
+	static avm::fault_injection::point_t late = {
+		FAULT_INJECT_POINT_VERSION, "late", "point", "Point of late module", 0, false, avm::fault_injection::mode_t::multiple, {}
+	};
+	static avm::fault_injection::point_t * module_points[] = { &late };
+	static avm::fault_injection::detail::module_points_t module = {
+		nullptr, std::begin(module_points), std::end(module_points), false
+	};
+
+	const avm::fault_injection::point_handle handle("late", "point");
+
+	BOOST_CHECK(handle.get() == nullptr);
+
+	avm::fault_injection::registerModuleImpl(&module);
+
+	BOOST_CHECK(handle.get() == &late);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
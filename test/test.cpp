@@ -4,9 +4,21 @@
 #include <boost/test/unit_test.hpp>
 
 #include <errno.h>
-
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <limits>
 #include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include <fault_injection.hpp>
 #include <fault_injection_test_helper.hpp>
@@ -16,6 +28,9 @@ DECLARE_FAULT_INJECTION_POINT(test, simple);
 FAULT_INJECTION_POINT(test, simple, "Simple fault");
 FAULT_INJECTION_POINT(test, second, "Second fault");
 FAULT_INJECTION_POINT_EX(test2, another, "Another", 0);
+FAULT_INJECTION_POINT_EX(storage::disk, write, "Disk write", EIO);
+FAULT_INJECTION_POINT_EX(storage::disk, read, "Disk read", EIO);
+FAULT_INJECTION_POINT_EX(storage::net, send, "Network send", ECONNRESET);
 
 static bool isInjected(const std::exception & e)
 {
@@ -28,7 +43,7 @@ BOOST_AUTO_TEST_CASE(foreach)
 {
 	using avm::fault_injection::points;
 
-	BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 3u);
+	BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 6u);
 
 	BOOST_CHECK(std::find_if(points.begin(), points.end(), [](const auto & point) {
 		return (strcmp(getSpace(point), "test") == 0) && (strcmp(getName(point), "simple") == 0);
@@ -45,7 +60,7 @@ BOOST_AUTO_TEST_CASE(foreach_const)
 {
 	const auto points = avm::fault_injection::points;
 
-	BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 3u);
+	BOOST_CHECK_EQUAL(std::distance(points.begin(), points.end()), 6u);
 
 	BOOST_CHECK(std::find_if(points.begin(), points.end(), [](const auto & point) {
 		return (strcmp(getSpace(point), "test") == 0) && (strcmp(getName(point), "simple") == 0);
@@ -77,6 +92,31 @@ BOOST_AUTO_TEST_CASE(move_beyond_the_end)
 	BOOST_CHECK(it == points.end());
 }
 
+BOOST_AUTO_TEST_CASE(view)
+{
+	using namespace avm::fault_injection;
+
+	const points_view view = getPointsView();
+
+	BOOST_CHECK_EQUAL(view.size(), 6u);
+	BOOST_CHECK(std::equal(view.begin(), view.end(), points.begin(), points.end(), [](const point_t * lhs, const point_t & rhs) {
+		return lhs == &rhs;
+	}));
+
+	// Storage is reused while registry is not changed
+	BOOST_CHECK(getPointsView().begin() == view.begin());
+
+	std::vector<point_t *> sorted(view.begin(), view.end());
+	auto less = [](const point_t * lhs, const point_t * rhs) {
+		const int result = strcmp(getSpace(*lhs), getSpace(*rhs));
+		return (result < 0) || ((result == 0) && (strcmp(getName(*lhs), getName(*rhs)) < 0));
+	};
+	std::sort(sorted.begin(), sorted.end(), less);
+
+	BOOST_CHECK(std::binary_search(sorted.begin(), sorted.end(), &FAULT_INJECTION_POINT_REF(test, second), less));
+	BOOST_CHECK(view[0] != nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(error_code)
@@ -173,6 +213,125 @@ BOOST_AUTO_TEST_CASE(error_condition_true)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(value)
+
+BOOST_AUTO_TEST_CASE(no_error)
+{
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), 5L);
+
+	const long value = FAULT_INJECT_VALUE(test, simple, 15L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(value, 15L);
+}
+
+BOOST_AUTO_TEST_CASE(error_missing)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+
+	const long value = FAULT_INJECT_VALUE(test, simple, 15L);
+
+	BOOST_CHECK(!avm::fault_injection::hasValue(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EQUAL(value, 0L);
+}
+
+BOOST_AUTO_TEST_CASE(error_integer)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), 5L);
+
+	const long value = FAULT_INJECT_VALUE(test, simple, 15L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(value, 5L);
+}
+
+BOOST_AUTO_TEST_CASE(error_type_mismatch)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), 5);
+
+	const long value = FAULT_INJECT_VALUE(test, simple, 15L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(value, 0L);
+}
+
+BOOST_AUTO_TEST_CASE(error_error_code)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), std::make_error_code(std::errc::connection_refused));
+
+	auto action = [] {
+		return std::error_code{};
+	};
+	const std::error_code value = FAULT_INJECT_VALUE(test, simple, action());
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK(value == std::errc::connection_refused);
+}
+
+BOOST_AUTO_TEST_CASE(error_pointer)
+{
+	static const char injected[] = "INJECTED";
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), injected);
+
+	const char * value = FAULT_INJECT_VALUE(test, simple, static_cast<const char *>(nullptr));
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK(value == injected);
+}
+
+BOOST_AUTO_TEST_CASE(error_by_name)
+{
+	avm::fault_injection::InjectionStateGuard guard("test", "simple");
+	avm::fault_injection::setValue("test", "simple", 5L);
+
+	const long value = FAULT_INJECT_VALUE(test, simple, 15L);
+
+	BOOST_CHECK(avm::fault_injection::hasValue("test", "simple"));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getValue<long>("test", "simple"), 5L);
+
+	avm::fault_injection::resetValue("test", "simple");
+
+	BOOST_CHECK_EQUAL(value, 5L);
+}
+
+BOOST_AUTO_TEST_CASE(error_oneshot)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::oneshot);
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), 5L);
+
+	const long value1 = FAULT_INJECT_VALUE(test, simple, 15L);
+	const long value2 = FAULT_INJECT_VALUE(test, simple, 16L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(value1, 5L);
+	BOOST_CHECK_EQUAL(value2, 16L);
+}
+
+BOOST_AUTO_TEST_CASE(error_condition_false)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::setValue(FAULT_INJECTION_POINT_REF(test, simple), 5L);
+	bool enabled = false;
+
+	const long value = FAULT_INJECT_VALUE_IF(test, simple, enabled, 15L);
+
+	avm::fault_injection::resetValue(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(value, 15L);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(guard)
 
 BOOST_AUTO_TEST_CASE(error_default)
@@ -250,6 +409,123 @@ BOOST_AUTO_TEST_CASE(error_oneshot_custom_error)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(error_set)
+
+BOOST_AUTO_TEST_CASE(sequence)
+{
+	const int codes[] = {EINTR, EAGAIN, EIO};
+	int values[4] = {};
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::multiple);
+		avm::fault_injection::setErrorSequence(FAULT_INJECTION_POINT_REF(storage::disk, read), codes, 3);
+
+		BOOST_CHECK(avm::fault_injection::hasErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+
+		for (int & value : values) {
+			errno = 0;
+			FAULT_INJECT_ERRNO(storage::disk, read, 0);
+			value = errno;
+		}
+
+		avm::fault_injection::resetErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read));
+
+		BOOST_CHECK(!avm::fault_injection::hasErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+		BOOST_CHECK_EQUAL(FAULT_INJECT_ERROR_CODE(storage::disk, read, 0), EIO);
+	}
+
+	BOOST_CHECK_EQUAL(values[0], EINTR);
+	BOOST_CHECK_EQUAL(values[1], EAGAIN);
+	BOOST_CHECK_EQUAL(values[2], EIO);
+	BOOST_CHECK_EQUAL(values[3], EINTR);
+}
+
+BOOST_AUTO_TEST_CASE(sequence_by_name)
+{
+	const int codes[] = {EAGAIN};
+
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	avm::fault_injection::setErrorSequence("storage::disk", "read", codes, 1);
+
+	const std::error_code value = FAULT_INJECT_ERROR(storage::disk, read, std::error_code());
+
+	avm::fault_injection::resetErrorSet("storage::disk", "read");
+
+	BOOST_CHECK(value == std::errc::resource_unavailable_try_again);
+	BOOST_CHECK(!avm::fault_injection::hasErrorSet("storage::disk", "read"));
+}
+
+BOOST_AUTO_TEST_CASE(sequence_threads)
+{
+	const int codes[] = {EINTR, EAGAIN, EIO};
+	int counts[3] = {};
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::multiple);
+		avm::fault_injection::setErrorSequence(FAULT_INJECTION_POINT_REF(storage::disk, read), codes, 3);
+
+		std::vector<std::vector<int>> results(4);
+		std::vector<std::thread> threads;
+
+		for (auto & result : results) {
+			threads.emplace_back([&result] {
+				for (int i = 0; i < 300; ++i) {
+					result.push_back(FAULT_INJECT_ERROR_CODE(storage::disk, read, 0));
+				}
+			});
+		}
+
+		for (auto & thread : threads) {
+			thread.join();
+		}
+
+		avm::fault_injection::resetErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read));
+
+		for (const auto & result : results) {
+			for (int value : result) {
+				++counts[(value == EINTR) ? 0 : (value == EAGAIN) ? 1 : 2];
+			}
+		}
+	}
+
+	// Shared position splits sequence evenly between threads
+	BOOST_CHECK_EQUAL(counts[0], 400);
+	BOOST_CHECK_EQUAL(counts[1], 400);
+	BOOST_CHECK_EQUAL(counts[2], 400);
+}
+
+BOOST_AUTO_TEST_CASE(weights)
+{
+	const int codes[] = {EINTR, EAGAIN, EIO};
+	const double weights[] = {3.0, 0.0, 1.0};
+	int counts[3] = {};
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::multiple);
+		avm::fault_injection::setErrorWeights(FAULT_INJECTION_POINT_REF(storage::disk, read), codes, weights, 3);
+
+		for (int i = 0; i < 4000; ++i) {
+			const int value = FAULT_INJECT_ERROR_CODE(storage::disk, read, 0);
+			++counts[(value == EINTR) ? 0 : (value == EAGAIN) ? 1 : 2];
+		}
+
+		avm::fault_injection::resetErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	}
+
+	BOOST_CHECK_EQUAL(counts[1], 0);
+	BOOST_CHECK_GT(counts[0], 2700);
+	BOOST_CHECK_GT(counts[2], 700);
+}
+
+BOOST_AUTO_TEST_CASE(weights_zero)
+{
+	const int codes[] = {EINTR};
+	const double weights[] = {0.0};
+
+	avm::fault_injection::setErrorWeights(FAULT_INJECTION_POINT_REF(storage::disk, read), codes, weights, 1);
+
+	BOOST_CHECK(!avm::fault_injection::hasErrorSet(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(errno_code)
 
 BOOST_AUTO_TEST_CASE(no_error)
@@ -502,6 +778,149 @@ BOOST_AUTO_TEST_CASE(error_condition_true)
 	BOOST_CHECK_EXCEPTION(FAULT_INJECT_EXCEPTION_IF(test, simple, enabled, std::runtime_error("INJECTED")), std::runtime_error, isInjected);
 }
 
+BOOST_AUTO_TEST_CASE(installed)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::multiple);
+
+	avm::fault_injection::setException(FAULT_INJECTION_POINT_REF(test, simple), std::make_exception_ptr(std::system_error(EIO, std::generic_category())));
+
+	BOOST_CHECK(avm::fault_injection::hasException(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EXCEPTION(FAULT_INJECT_EXCEPTION(test, simple, std::runtime_error("INJECTED")), std::system_error, [](const std::system_error & e) {
+		return e.code() == std::errc::io_error;
+	});
+
+	avm::fault_injection::resetException(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK(!avm::fault_injection::hasException(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EXCEPTION(FAULT_INJECT_EXCEPTION(test, simple, std::runtime_error("INJECTED")), std::runtime_error, isInjected);
+}
+
+BOOST_AUTO_TEST_CASE(installed_by_name)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::multiple);
+
+	avm::fault_injection::setException("test", "simple", std::make_exception_ptr(std::logic_error("INSTALLED")));
+
+	BOOST_CHECK_THROW(FAULT_INJECT_EXCEPTION(test, simple, std::runtime_error("INJECTED")), std::logic_error);
+
+	avm::fault_injection::resetException("test", "simple");
+
+	BOOST_CHECK(!avm::fault_injection::hasException("test", "simple"));
+	BOOST_CHECK(!avm::fault_injection::hasException(nullptr));
+}
+
+BOOST_AUTO_TEST_CASE(installed_same_object)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::multiple);
+
+	avm::fault_injection::setException(FAULT_INJECTION_POINT_REF(test, simple), std::make_exception_ptr(std::runtime_error("INSTALLED")));
+
+	const void * objects[2] = {};
+	for (const void *& object : objects) {
+		try {
+			FAULT_INJECT_EXCEPTION(test, simple, std::runtime_error("INJECTED"));
+		} catch (const std::runtime_error & e) {
+			object = &e;
+		}
+	}
+
+	avm::fault_injection::resetException(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK(objects[0] != nullptr);
+	BOOST_CHECK(objects[0] == objects[1]);
+}
+
+BOOST_AUTO_TEST_CASE(installed_concurrently)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::multiple);
+
+	const std::exception_ptr exceptions[] = {
+		std::make_exception_ptr(std::logic_error("FIRST")),
+		std::make_exception_ptr(std::logic_error("SECOND"))
+	};
+	avm::fault_injection::setException(FAULT_INJECTION_POINT_REF(test, simple), exceptions[0]);
+
+	// Replaced exception stays valid for threads rethrowing it
+	std::atomic<int> installed{0};
+	std::thread worker([&] {
+		for (int i = 0; i < 1000; ++i) {
+			try {
+				FAULT_INJECT_EXCEPTION(test, simple, std::runtime_error("INJECTED"));
+			} catch (const std::logic_error &) {
+				++installed;
+			}
+		}
+	});
+
+	for (int i = 0; i < 1000; ++i) {
+		avm::fault_injection::setException(FAULT_INJECTION_POINT_REF(test, simple), exceptions[i % 2]);
+	}
+	worker.join();
+
+	avm::fault_injection::resetException(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(installed.load(), 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(error)
+
+namespace
+{
+	// Minimal result type constructible from error code
+	struct result_t
+	{
+		result_t(int value): value{value} {}
+		result_t(std::error_code error): error{error} {}
+
+		int value = 0;
+		std::error_code error;
+	};
+}
+
+BOOST_AUTO_TEST_CASE(no_error)
+{
+	const std::error_code value = FAULT_INJECT_ERROR(storage::disk, write, std::error_code());
+
+	BOOST_CHECK(!value);
+}
+
+BOOST_AUTO_TEST_CASE(error)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, write));
+
+	const std::error_code value = FAULT_INJECT_ERROR(storage::disk, write, std::error_code());
+
+	BOOST_CHECK(value == std::errc::io_error);
+}
+
+BOOST_AUTO_TEST_CASE(error_result)
+{
+	result_t value1{0};
+	result_t value2{0};
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::oneshot);
+
+		value1 = FAULT_INJECT_ERROR(storage::net, send, result_t{15});
+		value2 = FAULT_INJECT_ERROR(storage::net, send, result_t{16});
+	}
+
+	BOOST_CHECK(value1.error == std::errc::connection_reset);
+	BOOST_CHECK(!value2.error);
+	BOOST_CHECK_EQUAL(value2.value, 16);
+}
+
+BOOST_AUTO_TEST_CASE(error_condition_false)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, write));
+	bool enabled = false;
+
+	const std::error_code value = FAULT_INJECT_ERROR_IF(storage::disk, write, enabled, std::error_code());
+
+	BOOST_CHECK(!value);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(action)
@@ -526,3 +945,1588 @@ BOOST_AUTO_TEST_CASE(with_action)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(hook)
+
+static void corrupt(avm::fault_injection::point_t &, void * context, void * argument)
+{
+	++*static_cast<int *>(context);
+	*static_cast<char *>(argument) = 'X';
+}
+
+BOOST_AUTO_TEST_CASE(no_hook)
+{
+	int calls = 0;
+	char buffer = 'A';
+	avm::fault_injection::installHook(FAULT_INJECTION_POINT_REF(test, simple), corrupt, &calls);
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	avm::fault_injection::removeHook(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(calls, 0);
+	BOOST_CHECK_EQUAL(buffer, 'A');
+}
+
+BOOST_AUTO_TEST_CASE(active_without_hook)
+{
+	char buffer = 'A';
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	BOOST_CHECK(!avm::fault_injection::hasHook(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EQUAL(buffer, 'A');
+}
+
+BOOST_AUTO_TEST_CASE(with_hook)
+{
+	int calls = 0;
+	char buffer = 'A';
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::installHook(FAULT_INJECTION_POINT_REF(test, simple), corrupt, &calls);
+
+	BOOST_CHECK(avm::fault_injection::hasHook(FAULT_INJECTION_POINT_REF(test, simple)));
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	avm::fault_injection::removeHook(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK(!avm::fault_injection::hasHook(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EQUAL(calls, 1);
+	BOOST_CHECK_EQUAL(buffer, 'X');
+}
+
+BOOST_AUTO_TEST_CASE(with_hook_by_name)
+{
+	int calls = 0;
+	char buffer = 'A';
+	avm::fault_injection::InjectionStateGuard guard("test", "simple", avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::installHook("test", "simple", corrupt, &calls);
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	BOOST_CHECK(avm::fault_injection::hasHook("test", "simple"));
+
+	avm::fault_injection::removeHook("test", "simple");
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	BOOST_CHECK_EQUAL(calls, 2);
+	BOOST_CHECK_EQUAL(buffer, 'X');
+}
+
+BOOST_AUTO_TEST_CASE(hook_oneshot)
+{
+	int calls = 0;
+	char buffer = 'A';
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::oneshot);
+	avm::fault_injection::installHook(FAULT_INJECTION_POINT_REF(test, simple), corrupt, &calls);
+
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+	FAULT_INJECT_HOOK(test, simple, &buffer);
+
+	avm::fault_injection::removeHook(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(calls, 1);
+}
+
+BOOST_AUTO_TEST_CASE(hook_condition_false)
+{
+	int calls = 0;
+	char buffer = 'A';
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple));
+	avm::fault_injection::installHook(FAULT_INJECTION_POINT_REF(test, simple), corrupt, &calls);
+	bool enabled = false;
+
+	FAULT_INJECT_HOOK_IF(test, simple, enabled, &buffer);
+
+	avm::fault_injection::removeHook(FAULT_INJECTION_POINT_REF(test, simple));
+
+	BOOST_CHECK_EQUAL(calls, 0);
+	BOOST_CHECK_EQUAL(buffer, 'A');
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(rate_limited)
+
+static int countInjected(int calls)
+{
+	int result = 0;
+
+	for (int i = 0; i < calls; ++i) {
+		if (FAULT_INJECT_ERROR_CODE(test, simple, 0) != 0) {
+			++result;
+		}
+	}
+
+	return result;
+}
+
+BOOST_AUTO_TEST_CASE(unlimited)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(countInjected(10), 10);
+}
+
+BOOST_AUTO_TEST_CASE(zero_rate)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), 0.0);
+
+	const int injected = countInjected(10);
+
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(injected, 0);
+}
+
+BOOST_AUTO_TEST_CASE(burst)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), 1.0, 3);
+
+	const int injected = countInjected(10);
+
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(injected, 3);
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+}
+
+BOOST_AUTO_TEST_CASE(refill)
+{
+	avm::fault_injection::InjectionStateGuard guard("test", "simple", avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit("test", "simple", 20.0);
+
+	const int injected1 = countInjected(10);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	const int injected2 = countInjected(10);
+
+	avm::fault_injection::setRateLimit("test", "simple", std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(injected1, 1);
+	BOOST_CHECK_EQUAL(injected2, 1);
+}
+
+// Rate above tick of coarse clock (250 per second for 4 ms tick)
+BOOST_AUTO_TEST_CASE(high_rate)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), 5000.0);
+
+	const auto start = std::chrono::steady_clock::now();
+	int injected = 0;
+	while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200)) {
+		injected += countInjected(10);
+	}
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_LE(injected, 5000.0 * elapsed + 1);
+	BOOST_CHECK_GE(injected, 5000.0 * elapsed / 2);
+}
+
+BOOST_AUTO_TEST_CASE(condition_false)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited, -10);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), 1.0);
+	bool enabled = false;
+
+	const int value1 = FAULT_INJECT_ERROR_CODE_IF(test, simple, enabled, 15);
+	const int value2 = FAULT_INJECT_ERROR_CODE(test, simple, 15);
+
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, simple), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(value1, 15);
+	BOOST_CHECK_EQUAL(value2, -10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(snapshot)
+
+BOOST_AUTO_TEST_CASE(restore)
+{
+	using namespace avm::fault_injection;
+
+	const avm::fault_injection::mode_t mode = getMode(FAULT_INJECTION_POINT_REF(test, simple));
+	{
+		RegistrySnapshot snapshot;
+
+		BOOST_CHECK_EQUAL(snapshot.size(), 6u);
+
+		activate(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::rate_limited);
+		setErrorCode(FAULT_INJECTION_POINT_REF(test, simple), -10);
+		activate("test2", "another");
+
+		snapshot.restore();
+
+		BOOST_CHECK(!isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+		BOOST_CHECK(getMode(FAULT_INJECTION_POINT_REF(test, simple)) == mode);
+		BOOST_CHECK_EQUAL(getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), 0);
+		BOOST_CHECK(!isActive("test2", "another"));
+
+		setErrorCode(FAULT_INJECTION_POINT_REF(test, second), 5);
+
+		snapshot.restore();
+
+		BOOST_CHECK_EQUAL(getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), 0);
+
+		activate(FAULT_INJECTION_POINT_REF(test, second));
+	}
+
+	BOOST_CHECK(!isActive(FAULT_INJECTION_POINT_REF(test, second)));
+}
+
+BOOST_AUTO_TEST_CASE(restore_triggered)
+{
+	using namespace avm::fault_injection;
+
+	activate(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::multiple);
+	{
+		RegistrySnapshot snapshot;
+
+		setMode(FAULT_INJECTION_POINT_REF(test, simple), avm::fault_injection::mode_t::oneshot);
+
+		const int value = FAULT_INJECT_ERROR_CODE(test, simple, 15);
+
+		BOOST_CHECK_EQUAL(value, 0);
+		BOOST_CHECK(!isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	}
+
+	BOOST_CHECK(isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK(getMode(FAULT_INJECTION_POINT_REF(test, simple)) == avm::fault_injection::mode_t::multiple);
+
+	deactivate(FAULT_INJECTION_POINT_REF(test, simple));
+}
+
+BOOST_AUTO_TEST_CASE(nested)
+{
+	using namespace avm::fault_injection;
+
+	RegistrySnapshot outer;
+
+	activate(FAULT_INJECTION_POINT_REF(test, simple));
+	{
+		RegistrySnapshot inner;
+
+		deactivate(FAULT_INJECTION_POINT_REF(test, simple));
+		activate(FAULT_INJECTION_POINT_REF(test, second));
+	}
+
+	BOOST_CHECK(isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK(!isActive(FAULT_INJECTION_POINT_REF(test, second)));
+
+	outer.restore();
+
+	BOOST_CHECK(!isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(multi_guard)
+
+BOOST_AUTO_TEST_CASE(apply_and_restore)
+{
+	using avm::fault_injection::mode_t;
+
+	avm::fault_injection::setMode(FAULT_INJECTION_POINT_REF(test, simple), mode_t::multiple);
+	{
+		avm::fault_injection::MultiInjectionStateGuard guard{
+			{FAULT_INJECTION_POINT_REF(test, simple), mode_t::oneshot, -10},
+			{"test", "second", -20},
+			{"test2", "another"},
+			{"test", "missing"},
+		};
+
+		BOOST_CHECK_EQUAL(guard.size(), 3u);
+
+		BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+		BOOST_CHECK(avm::fault_injection::getMode(FAULT_INJECTION_POINT_REF(test, simple)) == mode_t::oneshot);
+		BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), -10);
+		BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+		BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), -20);
+		BOOST_CHECK(avm::fault_injection::isActive("test2", "another"));
+	}
+
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK(avm::fault_injection::getMode(FAULT_INJECTION_POINT_REF(test, simple)) == mode_t::multiple);
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive("test2", "another"));
+}
+
+BOOST_AUTO_TEST_CASE(reverse_order)
+{
+	{
+		avm::fault_injection::MultiInjectionStateGuard guard{
+			{FAULT_INJECTION_POINT_REF(test, simple), -10},
+			{"test", "simple", -20},
+		};
+
+		BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), -20);
+	}
+
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel)
+{
+	auto run = [](const char * name, int error, bool & result) {
+		result = true;
+
+		for (int i = 0; i < 1000; ++i) {
+			avm::fault_injection::MultiInjectionStateGuard guard{
+				{"test", name, error},
+			};
+
+			result = result && (avm::fault_injection::getErrorCode("test", name) == error);
+		}
+	};
+
+	bool result1 = false;
+	bool result2 = false;
+	std::thread thread1{run, "simple", -10, std::ref(result1)};
+	std::thread thread2{run, "second", -20, std::ref(result2)};
+
+	thread1.join();
+	thread2.join();
+
+	BOOST_CHECK(result1);
+	BOOST_CHECK(result2);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, simple)));
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, simple)), 0);
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(group)
+
+static int diskWrite()
+{
+	return FAULT_INJECT_ERROR_CODE(storage::disk, write, 0);
+}
+
+static int networkSend()
+{
+	return FAULT_INJECT_ERROR_CODE(storage::net, send, 0);
+}
+
+BOOST_AUTO_TEST_CASE(unknown)
+{
+	BOOST_CHECK(!avm::fault_injection::activateGroup("missing"));
+	BOOST_CHECK(!avm::fault_injection::activateGroup("storage::missing"));
+	BOOST_CHECK(!avm::fault_injection::isGroupActive("missing"));
+}
+
+BOOST_AUTO_TEST_CASE(parent)
+{
+	BOOST_CHECK(avm::fault_injection::activateGroup("storage"));
+
+	BOOST_CHECK(avm::fault_injection::isGroupActive("storage"));
+	BOOST_CHECK(avm::fault_injection::isGroupActive("storage::disk"));
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, write)));
+	BOOST_CHECK_EQUAL(diskWrite(), EIO);
+	BOOST_CHECK_EQUAL(networkSend(), ECONNRESET);
+
+	BOOST_CHECK(avm::fault_injection::deactivateGroup("storage"));
+
+	BOOST_CHECK(!avm::fault_injection::isGroupActive("storage::disk"));
+	BOOST_CHECK_EQUAL(diskWrite(), 0);
+	BOOST_CHECK_EQUAL(networkSend(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(child)
+{
+	BOOST_CHECK(avm::fault_injection::activateGroup("storage::disk"));
+
+	BOOST_CHECK(!avm::fault_injection::isGroupActive("storage"));
+	BOOST_CHECK_EQUAL(diskWrite(), EIO);
+	BOOST_CHECK_EQUAL(networkSend(), 0);
+
+	// Child keeps own switch when parent is turned off
+	avm::fault_injection::activateGroup("storage");
+	avm::fault_injection::deactivateGroup("storage");
+
+	BOOST_CHECK_EQUAL(diskWrite(), EIO);
+
+	avm::fault_injection::deactivateGroup("storage::disk");
+
+	BOOST_CHECK_EQUAL(diskWrite(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(point_state)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK_EQUAL(networkSend(), ECONNRESET);
+	BOOST_CHECK_EQUAL(diskWrite(), 0);
+
+	// Group switch only adds points, active point isn't suppressed
+	avm::fault_injection::activateGroup("storage");
+	avm::fault_injection::deactivateGroup("storage");
+
+	BOOST_CHECK_EQUAL(networkSend(), ECONNRESET);
+	BOOST_CHECK_EQUAL(diskWrite(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(point_deactivated)
+{
+	avm::fault_injection::activateGroup("storage::disk");
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, write));
+	}
+
+	// Deactivation of point keeps it enabled by group
+	BOOST_CHECK_EQUAL(diskWrite(), EIO);
+
+	avm::fault_injection::deactivateGroup("storage::disk");
+
+	BOOST_CHECK_EQUAL(diskWrite(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(iterate)
+{
+	std::vector<std::string> names;
+
+	avm::fault_injection::forEachGroupPoint("storage", [&names](const avm::fault_injection::point_t & point) {
+		names.push_back(std::string(getSpace(point)) + "::" + getName(point));
+	});
+	std::sort(names.begin(), names.end());
+
+	const std::vector<std::string> expected{"storage::disk::read", "storage::disk::write", "storage::net::send"};
+	BOOST_CHECK_EQUAL_COLLECTIONS(names.begin(), names.end(), expected.begin(), expected.end());
+
+	unsigned int count = 0;
+	avm::fault_injection::forEachGroupPoint("storage::net", [&count](const avm::fault_injection::point_t &) {
+		++count;
+	});
+
+	BOOST_CHECK_EQUAL(count, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(replay)
+
+namespace
+{
+	// Removes temporary recording on exit
+	class TemporaryFile
+	{
+	public:
+		TemporaryFile()
+		{
+			const int fd = mkstemp(path_);
+			BOOST_REQUIRE(fd != -1);
+			close(fd);
+		}
+
+		~TemporaryFile()
+		{
+			unlink(path_);
+		}
+
+		const char * path() const
+		{
+			return path_;
+		}
+
+	private:
+		char path_[64] = "/tmp/fault_injection_replay.XXXXXX";
+	};
+
+	std::vector<bool> injected(int calls)
+	{
+		std::vector<bool> result;
+
+		for (int i = 0; i < calls; ++i) {
+			result.push_back(FAULT_INJECT_ERROR_CODE(test, second, 0) != 0);
+		}
+
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(record_and_replay)
+{
+	TemporaryFile file;
+	std::vector<bool> recorded;
+	std::vector<bool> worker_recorded;
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::rate_limited, -10);
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, second), 1e-3, 2);
+
+		BOOST_REQUIRE(avm::fault_injection::startRecording());
+		BOOST_CHECK(!avm::fault_injection::startRecording());
+
+		recorded = injected(5);
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, second), 1e-3, 1);
+		std::thread([&worker_recorded] { worker_recorded = injected(3); }).join();
+
+		BOOST_CHECK(avm::fault_injection::stopRecording(file.path()));
+
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, second), std::numeric_limits<double>::infinity());
+	}
+
+	BOOST_CHECK((recorded == std::vector<bool>{true, true, false, false, false}));
+	BOOST_CHECK((worker_recorded == std::vector<bool>{true, false, false}));
+
+	// Replay ignores mode of points
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple, -10);
+
+	BOOST_REQUIRE(avm::fault_injection::startReplay(file.path()));
+
+	const std::vector<bool> replayed = injected(5);
+	std::vector<bool> worker_replayed;
+	std::thread([&worker_replayed] { worker_replayed = injected(3); }).join();
+
+	avm::fault_injection::stopReplay();
+
+	BOOST_CHECK(replayed == recorded);
+	BOOST_CHECK(worker_replayed == worker_recorded);
+	BOOST_CHECK((injected(2) == std::vector<bool>{true, true}));
+}
+
+BOOST_AUTO_TEST_CASE(invalid_file)
+{
+	TemporaryFile file;
+
+	BOOST_CHECK(!avm::fault_injection::startReplay(file.path()));
+	BOOST_CHECK(!avm::fault_injection::startReplay("/nonexistent/recording"));
+	BOOST_CHECK(!avm::fault_injection::stopRecording(file.path()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(fuzzing)
+
+namespace
+{
+	std::vector<int> errors(int calls)
+	{
+		std::vector<int> result;
+
+		for (int i = 0; i < calls; ++i) {
+			result.push_back(FAULT_INJECT_ERROR_CODE(test, second, 0));
+		}
+
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(decisions)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::oneshot, -10);
+
+	const std::uint8_t data[] = {0x05};
+	{
+		avm::fault_injection::FuzzingGuard fuzzing(data, sizeof(data));
+
+		BOOST_REQUIRE(fuzzing.started());
+		// Input is exhausted after 8 hits
+		BOOST_CHECK((errors(10) == std::vector<int>{-10, 0, -10, 0, 0, 0, 0, 0, 0, 0}));
+
+		// Restart resets input
+		BOOST_CHECK(avm::fault_injection::startFuzzing(data, sizeof(data)));
+		BOOST_CHECK((errors(3) == std::vector<int>{-10, 0, -10}));
+	}
+
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+	BOOST_CHECK((errors(2) == std::vector<int>{-10, 0}));
+}
+
+BOOST_AUTO_TEST_CASE(error_codes)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple, -10);
+
+	const int codes[] = {-20, -30, -40};
+	avm::fault_injection::setFuzzErrorCodes(FAULT_INJECTION_POINT_REF(test, second), codes, 3);
+
+	// Bits from least significant: trigger bit followed by 2 bits of
+	// index also from least significant: 1 00, 1 11, 1 10, 0
+	const std::uint8_t data[] = {0b11111001, 0b00000000};
+	{
+		avm::fault_injection::FuzzingGuard fuzzing(data, sizeof(data));
+
+		BOOST_CHECK((errors(4) == std::vector<int>{-10, -40, -20, 0}));
+		// Fuzzer doesn't change point so settings made during session
+		// survive it
+		BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), -10);
+		avm::fault_injection::setErrorCode(FAULT_INJECTION_POINT_REF(test, second), -50);
+	}
+
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), -50);
+
+	avm::fault_injection::setFuzzErrorCodes(FAULT_INJECTION_POINT_REF(test, second), nullptr, 0);
+
+	BOOST_CHECK_EQUAL(avm::fault_injection::getErrorCode(FAULT_INJECTION_POINT_REF(test, second)), -50);
+}
+
+BOOST_AUTO_TEST_CASE(exclusive)
+{
+	const std::uint8_t data[] = {0xff};
+
+	BOOST_REQUIRE(avm::fault_injection::startRecording());
+	BOOST_CHECK(!avm::fault_injection::startFuzzing(data, sizeof(data)));
+
+	char path[] = "/tmp/fault_injection_fuzz.XXXXXX";
+	const int fd = mkstemp(path);
+	close(fd);
+	avm::fault_injection::stopRecording(path);
+	unlink(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(perturbation)
+
+static void perturbed(int calls)
+{
+	for (int i = 0; i < calls; ++i) {
+		FAULT_INJECT_PERTURBATION(test, second);
+	}
+}
+
+static std::uint64_t perturbations()
+{
+	const avm::fault_injection::perturbation_counts_t counts = avm::fault_injection::getPerturbationCounts();
+
+	return counts.yields + counts.spins + counts.migrations;
+}
+
+// Restores default intensity
+struct PerturbationGuard
+{
+	PerturbationGuard(double intensity)
+	{
+		avm::fault_injection::setPerturbation(FAULT_INJECTION_POINT_REF(test, second), intensity);
+	}
+
+	~PerturbationGuard()
+	{
+		avm::fault_injection::setPerturbation(FAULT_INJECTION_POINT_REF(test, second), 1.0);
+	}
+};
+
+BOOST_AUTO_TEST_CASE(inactive)
+{
+	const std::uint64_t before = perturbations();
+	perturbed(100);
+
+	BOOST_CHECK_EQUAL(perturbations(), before);
+}
+
+BOOST_AUTO_TEST_CASE(full_intensity)
+{
+#if defined(__linux__)
+	cpu_set_t before;
+	BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(before), &before), 0);
+#endif
+
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	PerturbationGuard perturbation(1.0);
+
+	const avm::fault_injection::perturbation_counts_t start = avm::fault_injection::getPerturbationCounts();
+
+	std::thread worker([] { perturbed(1000); });
+	perturbed(1000);
+	worker.join();
+
+	// Every trigger perturbs and all kinds are chosen
+	const avm::fault_injection::perturbation_counts_t end = avm::fault_injection::getPerturbationCounts();
+	BOOST_CHECK_EQUAL((end.yields - start.yields) + (end.spins - start.spins) + (end.migrations - start.migrations), 2000u);
+	BOOST_CHECK_GT(end.yields, start.yields);
+	BOOST_CHECK_GT(end.spins, start.spins);
+
+#if defined(__linux__)
+	if (CPU_COUNT(&before) > 1) {
+		BOOST_CHECK_GT(end.migrations, start.migrations);
+	}
+
+	// Migration doesn't change affinity of thread
+	cpu_set_t after;
+	BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(after), &after), 0);
+	BOOST_CHECK(CPU_EQUAL(&before, &after));
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(zero_intensity)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	PerturbationGuard perturbation(0.0);
+
+	const std::uint64_t before = perturbations();
+	perturbed(1000);
+
+	BOOST_CHECK_EQUAL(perturbations(), before);
+}
+
+BOOST_AUTO_TEST_CASE(half_intensity)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	PerturbationGuard perturbation(0.5);
+
+	const std::uint64_t before = perturbations();
+	perturbed(1000);
+	const std::uint64_t count = perturbations() - before;
+
+	BOOST_CHECK_GT(count, 300u);
+	BOOST_CHECK_LT(count, 700u);
+}
+
+BOOST_AUTO_TEST_CASE(by_name)
+{
+	avm::fault_injection::InjectionStateGuard guard("test", "second", avm::fault_injection::mode_t::multiple);
+	PerturbationGuard perturbation(1.0);
+	avm::fault_injection::setPerturbation("test", "second", 0.0);
+	avm::fault_injection::setPerturbation("test", "missing", 1.0);
+	avm::fault_injection::setPerturbation(nullptr, 1.0);
+
+	std::uint64_t before = perturbations();
+	perturbed(100);
+
+	BOOST_CHECK_EQUAL(perturbations(), before);
+
+	avm::fault_injection::setPerturbation("test", "second", 1.0);
+
+	before = perturbations();
+	perturbed(100);
+
+	BOOST_CHECK_EQUAL(perturbations(), before + 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(short_io)
+
+static std::size_t transferSize(std::size_t size)
+{
+	return FAULT_INJECT_IO_SIZE(test, second, size);
+}
+
+BOOST_AUTO_TEST_CASE(inactive)
+{
+	BOOST_CHECK_EQUAL(transferSize(100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(one_byte)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::setShortIo(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::short_io_t::one_byte);
+
+	BOOST_CHECK_EQUAL(transferSize(100), 1u);
+	BOOST_CHECK_EQUAL(transferSize(1), 1u);
+	BOOST_CHECK_EQUAL(transferSize(0), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(fixed)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::setShortIo("test", "second", avm::fault_injection::short_io_t::fixed, 10);
+
+	BOOST_CHECK_EQUAL(transferSize(100), 10u);
+	// Transfer is always short
+	BOOST_CHECK_EQUAL(transferSize(10), 9u);
+
+	avm::fault_injection::setShortIo("test", "second", avm::fault_injection::short_io_t::one_byte);
+}
+
+BOOST_AUTO_TEST_CASE(random)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::setShortIo(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::short_io_t::random);
+
+	for (int i = 0; i < 100; ++i) {
+		const std::size_t size = transferSize(16);
+
+		BOOST_CHECK_GE(size, 1u);
+		BOOST_CHECK_LT(size, 16u);
+	}
+
+	avm::fault_injection::setShortIo(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::short_io_t::one_byte);
+}
+
+BOOST_AUTO_TEST_CASE(pipe_transfer)
+{
+	int fds[2];
+	BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+
+	const char message[] = "partial write";
+	char buffer[sizeof(message)] = {};
+	std::vector<ssize_t> writes;
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+		avm::fault_injection::setShortIo(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::short_io_t::fixed, 4);
+
+		// Retry loop handles short writes
+		for (std::size_t offset = 0; offset < sizeof(message);) {
+			const ssize_t result = write(fds[1], message + offset, FAULT_INJECT_IO_SIZE(test, second, sizeof(message) - offset));
+			BOOST_REQUIRE_GT(result, 0);
+
+			writes.push_back(result);
+			offset += static_cast<std::size_t>(result);
+		}
+
+		avm::fault_injection::setShortIo(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::short_io_t::one_byte);
+	}
+
+	BOOST_CHECK_EQUAL(read(fds[0], buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(message)));
+	BOOST_CHECK_EQUAL(std::memcmp(buffer, message, sizeof(message)), 0);
+	BOOST_CHECK((writes == std::vector<ssize_t>{4, 4, 4, 1, 1}));
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(cascade)
+
+namespace
+{
+	// Restores cascade state of points touched by test case
+	class CascadeGuard
+	{
+	public:
+		~CascadeGuard()
+		{
+			for (avm::fault_injection::point_t * point : {&FAULT_INJECTION_POINT_REF(storage::disk, write), &FAULT_INJECTION_POINT_REF(storage::disk, read),
+			                                             &FAULT_INJECTION_POINT_REF(storage::net, send)}) {
+				avm::fault_injection::clearCascade(*point);
+				avm::fault_injection::setTriggerWindow(*point, 0, 0);
+				avm::fault_injection::setRateLimit(*point, std::numeric_limits<double>::infinity());
+				avm::fault_injection::deactivate(*point);
+			}
+			avm::fault_injection::setErrorCode(FAULT_INJECTION_POINT_REF(storage::net, send), ECONNRESET);
+		}
+	};
+
+	int writeDisk()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::disk, write, 0);
+	}
+
+	int readDisk()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::disk, read, 0);
+	}
+
+	int sendNet()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::net, send, 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(window)
+{
+	CascadeGuard guard;
+	int values[6] = {};
+
+	avm::fault_injection::setTriggerWindow(FAULT_INJECTION_POINT_REF(storage::disk, read), 2, 3);
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+
+	for (int & value : values) {
+		value = readDisk();
+	}
+
+	BOOST_CHECK_EQUAL(values[0], 0);
+	BOOST_CHECK_EQUAL(values[1], 0);
+	BOOST_CHECK_EQUAL(values[2], EIO);
+	BOOST_CHECK_EQUAL(values[3], EIO);
+	BOOST_CHECK_EQUAL(values[4], EIO);
+	BOOST_CHECK_EQUAL(values[5], 0);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+}
+
+BOOST_AUTO_TEST_CASE(window_reactivate)
+{
+	CascadeGuard guard;
+
+	avm::fault_injection::setTriggerWindow(FAULT_INJECTION_POINT_REF(storage::disk, read), 1, 2);
+
+	// Every activation gets full window
+	for (int round = 0; round < 2; ++round) {
+		avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+
+		BOOST_CHECK_EQUAL(readDisk(), 0);
+		BOOST_CHECK_EQUAL(readDisk(), EIO);
+		BOOST_CHECK_EQUAL(readDisk(), EIO);
+		BOOST_CHECK_EQUAL(readDisk(), 0);
+		BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+	}
+
+	// Activation of active point doesn't extend window
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(window_rate_limited)
+{
+	CascadeGuard guard;
+
+	avm::fault_injection::setTriggerWindow(FAULT_INJECTION_POINT_REF(storage::disk, read), 0, 2);
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(storage::disk, read), 0.0);
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::rate_limited);
+
+	// Triggers rejected by rate limit don't spend count
+	for (int i = 0; i < 5; ++i) {
+		BOOST_CHECK_EQUAL(readDisk(), 0);
+	}
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+
+	avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(storage::disk, read), std::numeric_limits<double>::infinity());
+
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+}
+
+BOOST_AUTO_TEST_CASE(activate)
+{
+	CascadeGuard guard;
+	int values[5] = {};
+
+	avm::fault_injection::cascade_t edge;
+	edge.count = 3;
+	BOOST_CHECK(avm::fault_injection::addCascade(FAULT_INJECTION_POINT_REF(storage::disk, write), FAULT_INJECTION_POINT_REF(storage::disk, read), edge));
+
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, write), avm::fault_injection::mode_t::oneshot);
+
+	BOOST_CHECK_EQUAL(writeDisk(), EIO);
+
+	for (int & value : values) {
+		value = readDisk();
+	}
+
+	BOOST_CHECK_EQUAL(values[0], EIO);
+	BOOST_CHECK_EQUAL(values[1], EIO);
+	BOOST_CHECK_EQUAL(values[2], EIO);
+	BOOST_CHECK_EQUAL(values[3], 0);
+	BOOST_CHECK_EQUAL(values[4], 0);
+}
+
+BOOST_AUTO_TEST_CASE(activate_delay)
+{
+	CascadeGuard guard;
+
+	avm::fault_injection::cascade_t edge;
+	edge.delay = 1;
+	edge.count = 1;
+	BOOST_CHECK(avm::fault_injection::addCascade("storage::disk", "write", "storage::disk", "read", edge));
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, write), avm::fault_injection::mode_t::oneshot);
+
+	BOOST_CHECK_EQUAL(writeDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(deactivate_and_error_code)
+{
+	CascadeGuard guard;
+
+	avm::fault_injection::cascade_t stop;
+	stop.action = avm::fault_injection::cascade_action_t::deactivate;
+	avm::fault_injection::cascade_t reconfigure;
+	reconfigure.action = avm::fault_injection::cascade_action_t::set_error_code;
+	reconfigure.error_code = ETIMEDOUT;
+
+	BOOST_CHECK(avm::fault_injection::addCascade(FAULT_INJECTION_POINT_REF(storage::disk, write), FAULT_INJECTION_POINT_REF(storage::disk, read), stop));
+	BOOST_CHECK(avm::fault_injection::addCascade(FAULT_INJECTION_POINT_REF(storage::disk, write), FAULT_INJECTION_POINT_REF(storage::net, send), reconfigure));
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+	BOOST_CHECK_EQUAL(sendNet(), ECONNRESET);
+
+	// Condition false doesn't inject so edges are not applied
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, write));
+	BOOST_CHECK_EQUAL(FAULT_INJECT_ERROR_CODE_IF(storage::disk, write, false, 0), 0);
+	BOOST_CHECK_EQUAL(readDisk(), EIO);
+
+	BOOST_CHECK_EQUAL(writeDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+	BOOST_CHECK_EQUAL(sendNet(), ETIMEDOUT);
+}
+
+BOOST_AUTO_TEST_CASE(clear)
+{
+	CascadeGuard guard;
+
+	avm::fault_injection::cascade_t edge;
+	BOOST_CHECK(avm::fault_injection::addCascade(FAULT_INJECTION_POINT_REF(storage::disk, write), FAULT_INJECTION_POINT_REF(storage::disk, read), edge));
+	BOOST_CHECK(!avm::fault_injection::addCascade("storage::disk", "write", "storage::disk", "missing", edge));
+
+	avm::fault_injection::clearCascade("storage::disk", "write");
+	avm::fault_injection::clearCascade(nullptr);
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, write));
+
+	BOOST_CHECK_EQUAL(writeDisk(), EIO);
+	BOOST_CHECK_EQUAL(readDisk(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(caller_filter)
+
+namespace
+{
+	std::uint64_t captured[2] = {};
+
+	// Generic wrapper used by many callers, it captures hashes of its
+	// callers when asked
+	__attribute__((noinline)) int sendWrapper(bool capture)
+	{
+		if (capture) {
+			captured[0] = avm::fault_injection::getCallerHash(1);
+			captured[1] = avm::fault_injection::getCallerHash(2);
+		}
+
+		return FAULT_INJECT_ERROR_CODE(storage::net, send, 0);
+	}
+
+	__attribute__((noinline)) int sendFirst(bool capture = false)
+	{
+		return sendWrapper(capture);
+	}
+
+	__attribute__((noinline)) int sendSecond()
+	{
+		return sendWrapper(false);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(return_address)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	sendFirst(true);
+	BOOST_CHECK(captured[0] != 0);
+
+	avm::fault_injection::setCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send), 1, captured, 1);
+
+	BOOST_CHECK(avm::fault_injection::hasCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send)));
+
+	const int first = sendFirst();
+	const int second = sendSecond();
+
+	avm::fault_injection::resetCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK_EQUAL(first, ECONNRESET);
+	BOOST_CHECK_EQUAL(second, 0);
+	BOOST_CHECK(!avm::fault_injection::hasCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send)));
+	BOOST_CHECK_EQUAL(sendSecond(), ECONNRESET);
+}
+
+BOOST_AUTO_TEST_CASE(stack_hash)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	sendFirst(true);
+	BOOST_CHECK(captured[1] != captured[0]);
+
+	avm::fault_injection::setCallerFilter("storage::net", "send", 2, &captured[1], 1);
+
+	// Same return address of wrapper but another caller of sendFirst()
+	const int other = sendFirst();
+	const int same = [] { return sendFirst(); }();
+
+	avm::fault_injection::resetCallerFilter("storage::net", "send");
+
+	BOOST_CHECK_EQUAL(other, 0);
+	BOOST_CHECK_EQUAL(same, 0);
+	BOOST_CHECK(!avm::fault_injection::hasCallerFilter("storage::net", "send"));
+}
+
+BOOST_AUTO_TEST_CASE(many)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	sendFirst(true);
+
+	// Filter set grows beyond initial capacity
+	std::vector<std::uint64_t> hashes(100);
+	for (std::size_t i = 0; i < hashes.size(); ++i) {
+		hashes[i] = (i + 1) * 0x9e3779b97f4a7c15ull;
+	}
+	hashes[57] = captured[0];
+
+	avm::fault_injection::setCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send), 1, hashes.data(), hashes.size());
+
+	const int first = sendFirst();
+	const int second = sendSecond();
+
+	avm::fault_injection::resetCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK_EQUAL(first, ECONNRESET);
+	BOOST_CHECK_EQUAL(second, 0);
+}
+
+BOOST_AUTO_TEST_CASE(thread)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	int first = 0;
+	int second = 0;
+
+	// Walk is bounded by stack of thread which is not main one
+	std::thread([&first, &second] {
+		sendFirst(true);
+
+		avm::fault_injection::setCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send), 1, captured, 1);
+
+		first = sendFirst();
+		second = sendSecond();
+	}).join();
+
+	avm::fault_injection::resetCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK(captured[0] != 0);
+	BOOST_CHECK_EQUAL(first, ECONNRESET);
+	BOOST_CHECK_EQUAL(second, 0);
+}
+
+BOOST_AUTO_TEST_CASE(outside_stack)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	// Frame chain which looks valid but lies in heap, e.g. saved frame
+	// pointer slot of code built without frame pointers
+	std::vector<const void *> frames(4);
+	frames[0] = &frames[2];
+	frames[3] = reinterpret_cast<const void *>(std::uintptr_t{0x1234});
+
+	const std::uint64_t hash = 0x1234;
+
+	avm::fault_injection::setCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send), 1, &hash, 1);
+
+	const bool matched = avm::fault_injection::detail::matchCaller(FAULT_INJECTION_POINT_REF(storage::net, send), frames.data());
+
+	avm::fault_injection::resetCallerFilter(FAULT_INJECTION_POINT_REF(storage::net, send));
+
+	BOOST_CHECK(!matched);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(site)
+
+namespace
+{
+	int readFirst()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::disk, read, 0);
+	}
+
+	int readSecond()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::disk, read, 0);
+	}
+
+	// Macros are expressions usable outside functions
+	const unsigned int outside_line = __LINE__ + 1;
+	const int outside_value = FAULT_INJECT_ERROR_CODE(storage::disk, read, 7);
+
+	struct Member
+	{
+		int value = FAULT_INJECT_ERROR_CODE(storage::disk, read, 8);
+	};
+
+	avm::fault_injection::site_t * findSite(const char * function)
+	{
+		avm::fault_injection::site_t * result = nullptr;
+
+		avm::fault_injection::forEachSite(FAULT_INJECTION_POINT_REF(storage::disk, read), [&result, function](avm::fault_injection::site_t & site) {
+			if (strcmp(site.function, function) == 0) {
+				result = &site;
+			}
+		});
+
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(foreach)
+{
+	avm::fault_injection::site_t * first = findSite("readFirst");
+	avm::fault_injection::site_t * second = findSite("readSecond");
+
+	BOOST_REQUIRE(first != nullptr);
+	BOOST_REQUIRE(second != nullptr);
+	BOOST_CHECK(first->point == &FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK_EQUAL(first->line + 5, second->line);
+	BOOST_CHECK(strstr(first->file, "test.cpp") != nullptr);
+
+	std::size_t count = 0;
+	avm::fault_injection::forEachSite([&count](const avm::fault_injection::site_t &) {
+		++count;
+	});
+
+	BOOST_CHECK_GT(count, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(find)
+{
+	avm::fault_injection::site_t * first = findSite("readFirst");
+	BOOST_REQUIRE(first != nullptr);
+
+	BOOST_CHECK(avm::fault_injection::findSite("test.cpp", first->line) == first);
+	BOOST_CHECK(avm::fault_injection::findSite(first->file, first->line) == first);
+	BOOST_CHECK(avm::fault_injection::findSite("est.cpp", first->line) == nullptr);
+	BOOST_CHECK(avm::fault_injection::findSite("test.cpp", 0) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(outside_function)
+{
+	BOOST_CHECK_EQUAL(outside_value, 7);
+
+	const avm::fault_injection::site_t * site = avm::fault_injection::findSite("test.cpp", outside_line);
+	BOOST_REQUIRE(site != nullptr);
+	BOOST_CHECK(site->point == &FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK_EQUAL(site->function, "");
+
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::multiple);
+
+	BOOST_CHECK_EQUAL(Member().value, EIO);
+}
+
+BOOST_AUTO_TEST_CASE(counters)
+{
+	avm::fault_injection::site_t & first = *findSite("readFirst");
+	avm::fault_injection::site_t & second = *findSite("readSecond");
+
+	avm::fault_injection::resetCounters(first);
+	avm::fault_injection::resetCounters(second);
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::oneshot);
+
+		readFirst();
+		readFirst();
+		readSecond();
+	}
+
+	// Inactive point isn't counted
+	readSecond();
+
+	BOOST_CHECK_EQUAL(avm::fault_injection::getEvaluated(first), 1u);
+	BOOST_CHECK_EQUAL(avm::fault_injection::getTriggered(first), 1u);
+	BOOST_CHECK_EQUAL(avm::fault_injection::getEvaluated(second), 0u);
+	BOOST_CHECK_EQUAL(avm::fault_injection::getTriggered(second), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(activate)
+{
+	avm::fault_injection::site_t & first = *findSite("readFirst");
+	avm::fault_injection::site_t & second = *findSite("readSecond");
+
+	avm::fault_injection::activateSite(second);
+
+	BOOST_CHECK(avm::fault_injection::isSiteSelected(second));
+	BOOST_CHECK(!avm::fault_injection::isSiteSelected(first));
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+
+	const int value1 = readFirst();
+	const int value2 = readSecond();
+
+	avm::fault_injection::activateSite(first);
+
+	const int value3 = readFirst();
+
+	avm::fault_injection::deactivateSite(second);
+
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+
+	const int value4 = readSecond();
+
+	avm::fault_injection::deactivateSite(first);
+	avm::fault_injection::deactivateSite(nullptr);
+
+	BOOST_CHECK_EQUAL(value1, 0);
+	BOOST_CHECK_EQUAL(value2, EIO);
+	BOOST_CHECK_EQUAL(value3, EIO);
+	BOOST_CHECK_EQUAL(value4, 0);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+	BOOST_CHECK_EQUAL(readSecond(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(selection_reset)
+{
+	avm::fault_injection::site_t & first = *findSite("readFirst");
+	avm::fault_injection::site_t & second = *findSite("readSecond");
+
+	// Deactivation ends selection
+	avm::fault_injection::activateSite(first);
+	avm::fault_injection::activateSite(second);
+	avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+
+	BOOST_CHECK(!avm::fault_injection::isSiteSelected(first));
+	BOOST_CHECK(!avm::fault_injection::isSiteSelected(second));
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK_EQUAL(readFirst(), EIO);
+	BOOST_CHECK_EQUAL(readSecond(), EIO);
+
+	// Activation for all sites ends selection too
+	avm::fault_injection::activateSite(first);
+	BOOST_CHECK_EQUAL(readSecond(), 0);
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	BOOST_CHECK(!avm::fault_injection::isSiteSelected(first));
+	BOOST_CHECK_EQUAL(readSecond(), EIO);
+
+	// One-shot deactivation by selected site
+	avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(storage::disk, read));
+	avm::fault_injection::activateSite(first, avm::fault_injection::mode_t::oneshot);
+	BOOST_CHECK_EQUAL(readFirst(), EIO);
+	BOOST_CHECK(!avm::fault_injection::isSiteSelected(first));
+
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::oneshot);
+	BOOST_CHECK_EQUAL(readSecond(), EIO);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(storage::disk, read)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(space)
+
+// Switch is applied where macros are expanded
+#define FAULT_INJECTION_SPACE_storage FAULT_INJECTION_OFF
+
+static_assert(FAULT_INJECTION_SPACE_ENABLED(storage::disk) == 0, "Space is turned off");
+static_assert(FAULT_INJECTION_SPACE_ENABLED(test) == 1, "Space is turned on by default");
+
+namespace
+{
+	int readStripped()
+	{
+		return FAULT_INJECT_ERROR_CODE(storage::disk, read, 0);
+	}
+
+	bool actionStripped()
+	{
+		bool called = false;
+
+		FAULT_INJECT_ACTION(storage::net, send, called = true);
+
+		return called;
+	}
+}
+
+#undef FAULT_INJECTION_SPACE_storage
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+	avm::fault_injection::InjectionStateGuard guard1(FAULT_INJECTION_POINT_REF(storage::disk, read), avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::InjectionStateGuard guard2(FAULT_INJECTION_POINT_REF(storage::net, send), avm::fault_injection::mode_t::multiple);
+
+	BOOST_CHECK_EQUAL(readStripped(), 0);
+	BOOST_CHECK(!actionStripped());
+	BOOST_CHECK_EQUAL(FAULT_INJECT_ERROR_CODE(storage::disk, read, 0), EIO);
+}
+
+BOOST_AUTO_TEST_CASE(no_sites)
+{
+	bool found = false;
+
+	avm::fault_injection::forEachSite([&found](const avm::fault_injection::site_t & site) {
+		found = found || (strcmp(site.function, "readStripped") == 0) || (strcmp(site.function, "actionStripped") == 0);
+	});
+
+	BOOST_CHECK(!found);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(expiry)
+
+static int expiring()
+{
+	return FAULT_INJECT_ERROR_CODE(test, second, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ttl)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), -10);
+	avm::fault_injection::setMode(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	avm::fault_injection::setTtl(FAULT_INJECTION_POINT_REF(test, second), 0.05);
+
+	BOOST_CHECK_EQUAL(expiring(), -10);
+	BOOST_CHECK_EQUAL(expiring(), -10);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+	BOOST_CHECK_EQUAL(expiring(), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+
+	// Expired deadline is removed so point can be activated again
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(test, second));
+	BOOST_CHECK_EQUAL(expiring(), -10);
+}
+
+BOOST_AUTO_TEST_CASE(activate_for)
+{
+	avm::fault_injection::InjectionStateGuard guard("test", "second", -10);
+
+	avm::fault_injection::activateFor("test", "second", 0.0);
+
+	BOOST_CHECK_EQUAL(expiring(), 0);
+	BOOST_CHECK(!avm::fault_injection::isActive("test", "second"));
+
+	avm::fault_injection::activateFor(FAULT_INJECTION_POINT_REF(test, second), 3600.0);
+
+	BOOST_CHECK_EQUAL(expiring(), -10);
+
+	avm::fault_injection::setTtl("test", "second", std::numeric_limits<double>::infinity());
+	avm::fault_injection::activateFor(nullptr, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(deactivate)
+{
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), -10);
+
+	avm::fault_injection::activateFor(FAULT_INJECTION_POINT_REF(test, second), 0.05);
+	avm::fault_injection::deactivate(FAULT_INJECTION_POINT_REF(test, second));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	// Deadline of previous activation doesn't limit the next one
+	avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(test, second));
+
+	BOOST_CHECK_EQUAL(expiring(), -10);
+	BOOST_CHECK_EQUAL(expiring(), -10);
+	BOOST_CHECK(avm::fault_injection::isActive(FAULT_INJECTION_POINT_REF(test, second)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(statistics)
+
+namespace
+{
+	using avm::fault_injection::detail::statistics_header_t;
+	using avm::fault_injection::detail::statistics_slot_t;
+
+	bool readSlot(const char * path, const char * space, const char * name, statistics_slot_t & result)
+	{
+		FILE * file = fopen(path, "rb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		statistics_header_t header;
+		bool found = false;
+
+		if ((fread(&header, sizeof(header), 1, file) == 1) && (std::memcmp(header.magic, avm::fault_injection::detail::statistics_magic, sizeof(header.magic)) == 0)) {
+			for (std::uint32_t i = 0; !found && (i < header.size) && (fread(&result, sizeof(result), 1, file) == 1); ++i) {
+				found = (std::strcmp(result.space, space) == 0) && (std::strcmp(result.name, name) == 0);
+			}
+		}
+
+		fclose(file);
+
+		return found;
+	}
+
+	int injectSecond()
+	{
+		return FAULT_INJECT_ERROR_CODE(test, second, 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(counters)
+{
+	char path[] = "/tmp/fault_injection_stats.XXXXXX";
+	close(mkstemp(path));
+
+	BOOST_REQUIRE(avm::fault_injection::startStatistics(path));
+	BOOST_CHECK(!avm::fault_injection::startStatistics(path));
+	{
+		avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple, -10);
+
+		for (int i = 0; i < 3; ++i) {
+			injectSecond();
+		}
+
+		avm::fault_injection::setMode(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::rate_limited);
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, second), 0.0);
+		injectSecond();
+		injectSecond();
+		avm::fault_injection::setRateLimit(FAULT_INJECTION_POINT_REF(test, second), std::numeric_limits<double>::infinity());
+	}
+	avm::fault_injection::stopStatistics();
+
+	// Not counted after stop
+	avm::fault_injection::InjectionStateGuard guard(FAULT_INJECTION_POINT_REF(test, second), avm::fault_injection::mode_t::multiple);
+	injectSecond();
+
+	statistics_slot_t slot;
+	BOOST_REQUIRE(readSlot(path, "test", "second", slot));
+	BOOST_CHECK_EQUAL(slot.evaluated, 5u);
+	BOOST_CHECK_EQUAL(slot.triggered, 3u);
+	BOOST_CHECK(slot.last_triggered != 0);
+
+	BOOST_REQUIRE(readSlot(path, "test", "simple", slot));
+	BOOST_CHECK_EQUAL(slot.evaluated, 0u);
+	BOOST_CHECK_EQUAL(slot.last_triggered, 0u);
+
+	unlink(path);
+}
+
+BOOST_AUTO_TEST_CASE(crash)
+{
+	char path[] = "/tmp/fault_injection_stats.XXXXXX";
+	close(mkstemp(path));
+
+	const pid_t pid = fork();
+	BOOST_REQUIRE(pid != -1);
+
+	if (pid == 0) {
+		if (avm::fault_injection::startStatistics(path)) {
+			avm::fault_injection::activate(FAULT_INJECTION_POINT_REF(test, second));
+
+			for (int i = 0; i < 7; ++i) {
+				injectSecond();
+			}
+		}
+
+		// Test framework intercepts abort
+		raise(SIGKILL);
+	}
+
+	int status = 0;
+	BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+	BOOST_CHECK(WIFSIGNALED(status));
+
+	statistics_slot_t slot;
+	BOOST_REQUIRE(readSlot(path, "test", "second", slot));
+	BOOST_CHECK_EQUAL(slot.evaluated, 7u);
+	BOOST_CHECK_EQUAL(slot.triggered, 7u);
+
+	unlink(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// -*- compile-command: "cd .. && make tools/fault-injection-stats" -*-
+// Prints statistics file written by startStatistics(), it can be used
+// after crash of process.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <fault_injection.hpp>
+
+using avm::fault_injection::detail::statistics_header_t;
+using avm::fault_injection::detail::statistics_slot_t;
+
+static void formatTime(std::uint64_t value, char * buffer, std::size_t size)
+{
+	if (value == 0) {
+		std::snprintf(buffer, size, "-");
+		return;
+	}
+
+	const time_t seconds = static_cast<time_t>(value / 1000000000u);
+	struct tm time;
+	gmtime_r(&seconds, &time);
+
+	const std::size_t length = strftime(buffer, size, "%Y-%m-%dT%H:%M:%S", &time);
+	std::snprintf(buffer + length, size - length, ".%03uZ", static_cast<unsigned int>(value % 1000000000u / 1000000u));
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc != 2) {
+		std::fprintf(stderr, "Usage: %s FILE\n", argv[0]);
+		return 2;
+	}
+
+	const int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		std::perror(argv[1]);
+		return 1;
+	}
+
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || (static_cast<std::size_t>(info.st_size) < sizeof(statistics_header_t))) {
+		std::fprintf(stderr, "%s: invalid statistics file\n", argv[1]);
+		close(fd);
+		return 1;
+	}
+
+	const std::size_t length = static_cast<std::size_t>(info.st_size);
+	void * data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		std::perror(argv[1]);
+		return 1;
+	}
+
+	const statistics_header_t & header = *static_cast<const statistics_header_t *>(data);
+	if ((std::memcmp(header.magic, avm::fault_injection::detail::statistics_magic, sizeof(header.magic)) != 0)
+	    || (header.version != avm::fault_injection::detail::statistics_version)
+	    || (header.size > header.capacity)
+	    || (length < sizeof(statistics_header_t) + sizeof(statistics_slot_t) * header.capacity)) {
+		std::fprintf(stderr, "%s: invalid statistics file\n", argv[1]);
+		munmap(data, length);
+		return 1;
+	}
+
+	const statistics_slot_t * slots = reinterpret_cast<const statistics_slot_t *>(&header + 1);
+
+	std::printf("%-24s %-24s %12s %12s  %s\n", "SPACE", "NAME", "EVALUATED", "TRIGGERED", "LAST TRIGGERED");
+	for (std::uint32_t i = 0; i < header.size; ++i) {
+		const statistics_slot_t & slot = slots[i];
+		char time[64];
+
+		formatTime(slot.last_triggered, time, sizeof(time));
+		std::printf("%-24.*s %-24.*s %12llu %12llu  %s\n",
+		            static_cast<int>(sizeof(slot.space)), slot.space,
+		            static_cast<int>(sizeof(slot.name)), slot.name,
+		            static_cast<unsigned long long>(slot.evaluated),
+		            static_cast<unsigned long long>(slot.triggered),
+		            time);
+	}
+
+	munmap(data, length);
+
+	return 0;
+}